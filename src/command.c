@@ -0,0 +1,147 @@
+/**
+ * File  : command.c
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdbool.h>
+#include <string.h>
+#include "filesystem_core.h"
+#include "filesystem_api.h"
+#include "command.h"
+
+/****************************************************
+ *                      PRIVATE                     *
+ ****************************************************/
+
+/**
+ * Tell whether the given character separates the words of a command.
+ * @param c: the character.
+ * @ret   true if c is a blank, false otherwise.
+ */
+static inline bool is_blank(char c) {
+	return c == ' ' || c == '\t';
+}
+
+/**
+ * Split the path starting at str in its names, up to the first blank: runs of slashes count as one.
+ * @param str  : the first character of the path.
+ * @param end  : the end of the line.
+ * @param path : reference to the path where the number of names will be stored.
+ * @param names: array where the names will be stored, with room for COMMAND_MAX_NAMES names.
+ * @ret   a pointer to the first character after the path.
+ * @post  path->depth is the number of names, or 0 if there are more than any file could have.
+ */
+static const char* parse_path(const char* str, const char* end, fs_path_t* path, fs_path_name_t* names) {
+	const char* name;
+
+	path->depth = 0;
+	path->names = names;
+
+	while (str < end && !is_blank(*str)) {
+		if (*str == '/') {
+			str++;
+			continue;
+		}
+
+		for (name = str; str < end && *str != '/' && !is_blank(*str); str++);
+
+		if (path->depth < COMMAND_MAX_NAMES) {
+			names[path->depth].str = name;
+			names[path->depth].len = (size_t)(str - name);
+		}
+
+		path->depth++;
+	}
+
+	if (path->depth > COMMAND_MAX_NAMES)
+		path->depth = 0;
+
+	return str;
+}
+
+/****************************************************
+ *                      PUBLIC                      *
+ ****************************************************/
+
+bool command_parse(const char* line, size_t len, command_t* cmd, fs_path_name_t* names) {
+	const char *str, *end, *word;
+
+	end = line + len;
+
+	for (str = line; str < end && is_blank(*str); str++);
+
+	if (str == end)
+		return false;
+
+	/* The long forms of the commands (create_dir and delete_r) are the only words longer than 6 characters. */
+	for (word = str; str < end && !is_blank(*str); str++);
+
+	cmd->code = *word;
+	cmd->flag = str - word > 6;
+
+	for (; str < end && is_blank(*str); str++);
+
+	cmd->arg      = str < end ? str : NULL;
+	str           = parse_path(str, end, &cmd->path, names);
+	cmd->arg_len  = cmd->arg != NULL ? (size_t)(str - cmd->arg) : 0;
+	cmd->data     = NULL;
+	cmd->data_len = 0;
+
+	if ((cmd->code == COMMAND_WRITE || cmd->code == COMMAND_APPEND) && cmd->arg != NULL) {
+		str = memchr(str, '"', (size_t)(end - str));
+
+		if (str != NULL) {
+			cmd->data     = ++str;
+			str           = memchr(str, '"', (size_t)(end - str));
+			cmd->data_len = (size_t)((str != NULL ? str : end) - cmd->data);
+		}
+	}
+
+	return true;
+}
+
+bool command_run(const command_t* cmd) {
+	switch (cmd->code) {
+		case COMMAND_CREATE:
+			fs_create(&cmd->path, cmd->flag);
+			break;
+
+		case COMMAND_DELETE:
+			fs_delete(&cmd->path, cmd->flag);
+			break;
+
+		case COMMAND_READ:
+			fs_read(&cmd->path);
+			break;
+
+		case COMMAND_WRITE:
+			/* The content is only scanned once, and copied straight from the buffer of the input. */
+			fs_write(&cmd->path, cmd->data, cmd->data_len);
+			break;
+
+		case COMMAND_APPEND:
+			fs_append(&cmd->path, cmd->data, cmd->data_len);
+			break;
+
+		case COMMAND_FIND:
+			fs_find(cmd->arg, cmd->arg_len);
+			break;
+
+		case COMMAND_EXIT:
+			fs_exit();
+			return true;
+	}
+
+	return false;
+}
@@ -0,0 +1,68 @@
+/**
+ * File  : command.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef API_PROJECT_COMMAND_INCLUDED
+#define API_PROJECT_COMMAND_INCLUDED
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "filesystem_core.h"
+
+#define COMMAND_CREATE 'c'
+#define COMMAND_DELETE 'd'
+#define COMMAND_READ   'r'
+#define COMMAND_WRITE  'w'
+#define COMMAND_APPEND 'a'
+#define COMMAND_FIND   'f'
+#define COMMAND_EXIT   'e'
+
+/* The most names a command can store: any more and the path refers to no file. */
+#define COMMAND_MAX_NAMES (MAX_FILESYSTEM_DEPTH + 1)
+
+typedef struct command_s command_t;
+
+/**
+ * A command read from a line, made of views inside the line itself: nothing is copied and the line isn't modified.
+ */
+struct command_s {
+	char code;
+	bool flag;
+	fs_path_t path;
+	const char* arg;
+	size_t arg_len;
+	const char* data;
+	size_t data_len;
+};
+
+/**
+ * Parse a line in a single pass: the command word, then the path (split in its names), then the content of a write or append, which is whatever is between the first quote after the path and the next one (or the end of the line).
+ * @param line : the line read.
+ * @param len  : the length of the line.
+ * @param cmd  : reference to the command where the result will be stored.
+ * @param names: array where the names of the path will be stored, with room for COMMAND_MAX_NAMES names.
+ * @ret   true if the line contains a command, false if it is blank.
+ * @post  the command points inside line and names, which must stay valid as long as it's used.
+ */
+bool command_parse(const char* line, size_t len, command_t* cmd, fs_path_name_t* names);
+
+/**
+ * Run a command through the filesystem API; unknown commands are ignored.
+ * @param cmd: the command.
+ * @ret   true if the command was an exit, false otherwise.
+ */
+bool command_run(const command_t* cmd);
+
+#endif
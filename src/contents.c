@@ -0,0 +1,109 @@
+/**
+ * File  : contents.c
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "utils.h"
+#include "intern.h"
+#include "contents.h"
+
+/****************************************************
+ *                      PRIVATE                     *
+ ****************************************************/
+
+/* Initial (and minimum) size of the table of contents, a power of two as required by intern_init. */
+#ifndef CONTENTS_TABLE_INIT_SIZE
+#define CONTENTS_TABLE_INIT_SIZE 1024
+#endif
+
+static intern_table_t contents_table;
+
+/* Total number of references and total length of the contents referenced, counting each reference. */
+static size_t         contents_refs;
+static size_t         contents_bytes;
+
+/* Total length of the contents in the table, counting each of them once. */
+static size_t         contents_stored;
+
+/****************************************************
+ *                      PUBLIC                      *
+ ****************************************************/
+
+void contents_init(void) {
+	intern_init(&contents_table, CONTENTS_TABLE_INIT_SIZE, offsetof(fs_content_t, str));
+
+	contents_refs   = 0;
+	contents_bytes  = 0;
+	contents_stored = 0;
+}
+
+void contents_exit(void) {
+	size_t i;
+
+	for (i = 0; i < contents_table.size; i++)
+		free(contents_table.cells[i]);
+
+	intern_exit(&contents_table);
+}
+
+fs_content_t* content_intern(const char* str, size_t len) {
+	fs_content_t* content;
+	uint64_t h;
+	size_t i;
+
+	contents_refs++;
+	contents_bytes += len;
+
+	h = intern_hash(&contents_table, str, len);
+	i = intern_probe(&contents_table, str, len, h);
+
+	if (contents_table.cells[i] != NULL) {
+		contents_table.cells[i]->refs++;
+		return (fs_content_t*)contents_table.cells[i];
+	}
+
+	content             = malloc_or_die(sizeof(fs_content_t) + len + 1);
+	content->entry.refs = 1;
+	content->entry.len  = len;
+	content->entry.hash = h;
+	memcpy(content->str, str, len);
+	content->str[len] = '\0';
+
+	intern_insert(&contents_table, i, &content->entry);
+	contents_stored += len;
+
+	return content;
+}
+
+void content_release(fs_content_t* content) {
+	contents_refs--;
+	contents_bytes -= content->entry.len;
+
+	if (--content->entry.refs > 0)
+		return;
+
+	intern_remove(&contents_table, &content->entry);
+	contents_stored -= content->entry.len;
+	free(content);
+}
+
+void contents_stats(fs_contents_stats_t* stats) {
+	stats->refs   = contents_refs;
+	stats->bytes  = contents_bytes;
+	stats->count  = contents_table.count;
+	stats->stored = contents_stored;
+}
@@ -0,0 +1,83 @@
+/**
+ * File  : contents.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef API_PROJECT_CONTENTS_INCLUDED
+#define API_PROJECT_CONTENTS_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include "intern.h"
+
+typedef struct fs_content_s        fs_content_t;
+typedef struct fs_contents_stats_s fs_contents_stats_t;
+
+struct fs_content_s {
+	intern_entry_t entry;
+	char str[];
+};
+
+/**
+ * How much the contents in the table would take if each reference had its own copy, compared to what they actually take.
+ */
+struct fs_contents_stats_s {
+	size_t refs;
+	size_t bytes;
+	size_t count;
+	size_t stored;
+};
+
+/**
+ * Initialize the table of contents with a random seed.
+ * @post the table of contents has been allocated in memory and is empty.
+ */
+void contents_init(void);
+
+/**
+ * Destroy the table of contents, freeing at once all the contents which haven't been released yet.
+ */
+void contents_exit(void);
+
+/**
+ * Get the unique copy of a content, adding it to the table if needed, and take a reference to it.
+ * @param str: the content to intern (not necessarily NUL-terminated).
+ * @param len: the length of the content.
+ * @ret   a pointer to the interned content, which is the same for every equal string, with its refs increased by one.
+ */
+fs_content_t* content_intern(const char* str, size_t len);
+
+/**
+ * Release a reference to an interned content, removing it from the table and freeing it if it was the last one.
+ * @param content: the content to release.
+ * @pre   content has been returned by content_intern.
+ */
+void content_release(fs_content_t* content);
+
+/**
+ * Get the interned content whose string is at the given address.
+ * @param str: the str field of an interned content.
+ * @ret   a pointer to the content.
+ */
+static inline fs_content_t* content_of(const char* str) {
+	return (fs_content_t*)(str - offsetof(fs_content_t, str));
+}
+
+/**
+ * Count the references to the contents in the table and their total length, with and without duplicates.
+ * @param stats: reference to the structure where the counters will be stored.
+ */
+void contents_stats(fs_contents_stats_t* stats);
+
+#endif
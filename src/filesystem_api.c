@@ -19,112 +19,240 @@
  */
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
+#include <unistd.h>
 #include "utils.h"
+#include "writer.h"
+#include "proto.h"
 #include "filesystem_core.h"
 #include "filesystem_api.h"
+#ifdef FS_DEDUP_CONTENTS
+#include "contents.h"
+#endif
+
+/****************************************************
+ *                      PRIVATE                     *
+ ****************************************************/
+
+/* Results are collected here and written out in large blocks, without going through printf. */
+static writer_t fs_output;
+
+/* Whether results are written in the binary protocol instead of as text. */
+static bool fs_binary;
+
+/**
+ * Output a result made of a single token.
+ * @param success: whether the result is RESULT_SUCCESS or RESULT_FAILURE.
+ */
+static void result(bool success) {
+	if (fs_binary)
+		writer_char(&fs_output, success ? PROTO_SUCCESS : PROTO_FAILURE);
+	else if (success)
+		writer_str(&fs_output, RESULT_SUCCESS"\n", sizeof(RESULT_SUCCESS"\n") - 1);
+	else
+		writer_str(&fs_output, RESULT_FAILURE"\n", sizeof(RESULT_FAILURE"\n") - 1);
+
+	writer_done(&fs_output);
+}
+
+/**
+ * Output a result made of RESULT_SUCCESS followed by a number.
+ * @param n: the number.
+ */
+static void result_num(size_t n) {
+	if (fs_binary) {
+		writer_char(&fs_output, PROTO_SUCCESS);
+		writer_varint(&fs_output, n);
+	} else {
+		writer_str(&fs_output, RESULT_SUCCESS" ", sizeof(RESULT_SUCCESS" ") - 1);
+		writer_num(&fs_output, n);
+		writer_char(&fs_output, '\n');
+	}
+
+	writer_done(&fs_output);
+}
+
+/**
+ * Output a line made of the given token followed by a string (or, in the binary protocol, the string preceded by its length), without marking the end of the result.
+ * @param token: the token, followed by a space.
+ * @param len  : the length of the token.
+ * @param str  : the string (not necessarily NUL-terminated).
+ * @param n    : the length of the string.
+ */
+static void result_str(const char* token, size_t len, const char* str, size_t n) {
+	if (fs_binary) {
+		writer_varint(&fs_output, n);
+		writer_str(&fs_output, str, n);
+		return;
+	}
+
+	writer_str(&fs_output, token, len);
+	writer_str(&fs_output, str, n);
+	writer_char(&fs_output, '\n');
+}
+
+/****************************************************
+ *                      PUBLIC                      *
+ ****************************************************/
 
 void fs_init(void) {
+	writer_init(&fs_output, STDOUT_FILENO);
 	fs__init();
 }
 
+void fs_flush(void) {
+	writer_flush(&fs_output);
+}
+
+void fs_protocol(bool binary) {
+	fs_binary = binary;
+}
+
+void fs_redirect(char* (*hand)(char* buf, size_t len)) {
+	writer_hand(&fs_output, hand);
+}
+
+void fs_stats(void) {
+#ifdef FS_DEDUP_CONTENTS
+	fs_contents_stats_t stats;
+
+	/* Contents stored in the files themselves or grown by append aren't shared, and aren't counted. */
+	contents_stats(&stats);
+	fprintf(stderr, "contents: %zu bytes in %zu files, stored as %zu bytes in %zu buffers (dedup ratio %.2f)\n",
+	        stats.bytes, stats.refs, stats.stored, stats.count, stats.stored > 0 ? (double)stats.bytes / (double)stats.stored : 1.0);
+#endif
+}
+
 void fs_exit(void) {
+	fs_stats();
+	writer_free(&fs_output);
 	fs__exit();
 }
 
-void fs_create(char* path, bool is_dir) {
-	fs_file_t** new_file;
+void fs_create(const fs_path_t* path, bool is_dir) {
+	fs_file_t* new_file;
 
 	new_file = fs__get(path, true, is_dir);
 
 	if (new_file != NULL) {
-		printf(RESULT_SUCCESS"\n");
+		result(true);
 		return;
 	}
 
-	printf(RESULT_FAILURE"\n");
+	result(false);
 }
 
-void fs_delete(char* path, bool recursive) {
-	fs_file_t** victim;
+void fs_delete(const fs_path_t* path, bool recursive) {
+	fs_file_t* victim;
 
 	victim = fs__get(path, false, false);
 
 	if (victim != NULL) {
-		if (recursive || (*victim)->n_children == 0) {
-			if ((*victim)->l_sibling != NULL)
-				fs__del(&(*victim)->l_sibling->r_sibling);
-			else
-				fs__del(&(*victim)->parent->content.l_child);
+		if (recursive || victim->n_children == 0) {
+			fs__del(victim);
 
-			printf(RESULT_SUCCESS"\n");
+			result(true);
 			return;
 		}
 	}
 
-	printf(RESULT_FAILURE"\n");
+	result(false);
 }
 
-void fs_read(char* path) {
-	fs_file_t** file;
+void fs_read(const fs_path_t* path) {
+	fs_file_t* file;
+	const char* data;
+	size_t data_len;
 
 	file = fs__get(path, false, false);
 
-	if (file != NULL && !(*file)->is_dir) {
-		printf(RESULT_READ_SUCCESS" %s\n", (*file)->content.data);
+	if (file != NULL && !file->is_dir) {
+		data = fs__data(file, &data_len);
+
+		/* A large content isn't copied: it's written together with the results before it, straight from the buffer of the file. */
+		if (fs_binary) {
+			writer_char(&fs_output, PROTO_SUCCESS);
+			writer_varint(&fs_output, data_len);
+			writer_ref(&fs_output, data, data_len);
+		} else {
+			writer_str(&fs_output, RESULT_READ_SUCCESS" ", sizeof(RESULT_READ_SUCCESS" ") - 1);
+			writer_ref(&fs_output, data, data_len);
+			writer_char(&fs_output, '\n');
+		}
+
+		writer_done(&fs_output);
 		return;
 	}
 
-	printf(RESULT_FAILURE"\n");
+	result(false);
 }
 
-void fs_write(char* path, const char* data) {
-	fs_file_t** file;
-	size_t data_len;
+void fs_write(const fs_path_t* path, const char* data, size_t data_len) {
+	fs_file_t* file;
 
 	file = fs__get(path, false, false);
 
-	if (file != NULL && !(*file)->is_dir) {
-		free((*file)->content.data);
-		data_len = strlen(data);
-		(*file)->content.data = malloc_or_die(data_len + 1);
-		strcpy((*file)->content.data, data);
+	/* Contents have to fit in 32 bits, as for append. */
+	if (file != NULL && !file->is_dir && data != NULL && data_len < UINT32_MAX) {
+		fs__write(file, data, data_len);
+
+		result_num(data_len);
+		return;
+	}
+
+	result(false);
+}
+
+void fs_append(const fs_path_t* path, const char* data, size_t data_len) {
+	fs_file_t* file;
+
+	file = fs__get(path, false, false);
 
-		printf(RESULT_SUCCESS" %zu\n", data_len);
+	if (file != NULL && !file->is_dir && data != NULL && fs__append(file, data, data_len)) {
+		result_num(data_len);
 		return;
 	}
 
-	printf(RESULT_FAILURE"\n");
+	result(false);
 }
 
-void fs_find(const char* name) {
+void fs_find(const char* name, size_t len) {
 	fs_file_t** found;
 	register size_t i;
-	char** paths;
-	size_t n;
+	size_t n, size;
+	char* path;
 
 	n = 0;
 	if (name != NULL)
-		found = fs__all(fs_root, name, &n);
+		found = fs__all(fs_root, name, len, &n);
 
 	if (n > 0) {
-		paths = malloc_or_die(sizeof(char*) * n);
+		for (size = 0, i = 0; i < n; i++) {
+			if (fs__cold(found[i])->path_len > size)
+				size = fs__cold(found[i])->path_len;
+		}
 
-		for (i = 0; i < n; i++)
-			paths[i] = fs__uri(found[i], 0);
-		free(found);
+		/* The matches are already sorted: each path is written over the previous one, only from their common ancestor on. */
+		path = malloc_or_die(size + 1);
 
-		qsort(paths, n, sizeof(fs_file_t*), fs__cmp);
+		if (fs_binary) {
+			writer_char(&fs_output, PROTO_SUCCESS);
+			writer_varint(&fs_output, n);
+		}
 
 		for (i = 0; i < n; i++) {
-			printf(RESULT_SUCCESS" %s\n", paths[i]);
-			free(paths[i]);
+			fs__path(path, found[i], i > 0 ? found[i - 1] : NULL);
+			result_str(RESULT_SUCCESS" ", sizeof(RESULT_SUCCESS" ") - 1, path, fs__cold(found[i])->path_len);
 		}
 
-		free(paths);
+		writer_done(&fs_output);
+
+		free(path);
+		free(found);
 		return;
 	}
 
-	printf(RESULT_FAILURE"\n");
+	result(false);
 }
@@ -22,62 +22,100 @@
 #define API_PROJECT_FS_API_INCLUDED
 
 #include <stdbool.h>
+#include <stddef.h>
+#include "filesystem_core.h"
 
 #define RESULT_SUCCESS      "ok"
 #define RESULT_READ_SUCCESS "contenuto"
 #define RESULT_FAILURE      "no"
 
 /**
- * Nothing but a wrapper of fs__init: initialize the hash table and create the root.
+ * Nothing but a wrapper of fs__init: initialize the hash table and create the root, plus the buffer where results are collected before being written to stdout.
  * @post the hash table has been allocated in memory and the root has been created.
  */
 void fs_init(void);
 
 /**
- * Nothing but a wrapper of fs__exit: destroy the whole filesystem tree (including root) and free all the space.
+ * Write out the results still waiting in the output buffer: results are only written when the buffer is full, when the input is needed again, or one by one if the output is a terminal.
+ * @post all the results produced so far have been written to stdout.
+ */
+void fs_flush(void);
+
+/**
+ * Choose the format of the results: text (the default) or the binary protocol described in doc/Binary protocol.md.
+ * @param binary: whether to use the binary protocol.
+ */
+void fs_protocol(bool binary);
+
+/**
+ * Hand the buffer of results over to the given function every time it would be written to stdout, instead of writing it (see writer_hand).
+ * @param hand: function taking a full buffer and the length of its content and returning an empty one, NULL to go back to writing to stdout.
+ */
+void fs_redirect(char* (*hand)(char* buf, size_t len));
+
+/**
+ * With FS_DEDUP_CONTENTS, print on stderr how much the shared contents would take without deduplication; do nothing otherwise.
+ * Called by fs_exit, and at the end of the input when there's no exit command.
+ */
+void fs_stats(void);
+
+/**
+ * Nothing but a wrapper of fs__exit: destroy the whole filesystem tree (including root) and free all the space, after writing out the pending results and printing the statistics of fs_stats.
  * @post the whole filesystem tree and hashtable have been freed.
  */
 void fs_exit(void);
 
 /**
  * Create a file represented by the given path.
- * @param path  : the path representing the file to be created.
+ * @param path  : the path representing the file to be created, split in its names.
  * @param is_dir: whether the file to be created is a directory or not.
  * @post  in case of success the new file is in the proper position in both the hash table and the tree.
  * @out   RESULT_SUCCESS in case of success; RESULT_ERROR in case of error.
  */
-void fs_create(char* path, bool is_dir);
+void fs_create(const fs_path_t* path, bool is_dir);
 
 /**
  * Delete the file represented by the given path and, if requested and if any, all its children.
- * @param path     : the path representing the file to be deleted.
+ * @param path     : the path representing the file to be deleted, split in its names.
  * @param recursive: whether to delete all the file's children (recursively) or not.
  * @post  in case of success, the file has been removed from both the hash table and the tree.
  * @out   RESULT_SUCCESS in case of success; RESULT_ERROR in case of error.
  */
-void fs_delete(char* path, bool recursive);
+void fs_delete(const fs_path_t* path, bool recursive);
 
 /**
  * Output the content of the file represented by the given path.
- * @param path: the path representing the file to read.
+ * @param path: the path representing the file to read, split in its names.
  * @out   RESULT_READ_SUCCESS followed by the file's content in case of success; RESULT_ERROR in case of error.
  */
-void fs_read(char* path);
+void fs_read(const fs_path_t* path);
 
 /**
  * Write the given data to the file represented by the given path.
- * @param path: the path representing the file to write to.
- * @param data: the string to be written to the file.
+ * @param path: the path representing the file to write to, split in its names.
+ * @param data: the data to be written to the file (not necessarily NUL-terminated), NULL if missing.
+ * @param len : the length of data.
  * @post  the file contains the given data.
  * @out   RESULT_SUCCESS followed by the length of data in case of success; RESULT_ERROR in case of error.
  */
-void fs_write(char* path, const char* data);
+void fs_write(const fs_path_t* path, const char* data, size_t len);
+
+/**
+ * Append the given data to the file represented by the given path.
+ * @param path: the path representing the file to append to, split in its names.
+ * @param data: the data to be appended to the file (not necessarily NUL-terminated), NULL if missing.
+ * @param len : the length of data.
+ * @post  the content of the file is followed by the given data.
+ * @out   RESULT_SUCCESS followed by the length of data in case of success; RESULT_ERROR in case of error.
+ */
+void fs_append(const fs_path_t* path, const char* data, size_t len);
 
 /**
  * Find all the files of the filesystem with the given name.
- * @param name: the name to search for.
+ * @param name: the name to search for (not necessarily NUL-terminated), NULL if missing.
+ * @param len : the length of the name.
  * @out   RESULT_SUCCESS followed by the full path of the matching file, one line per match, sorted lexicographically, in case of success; RESULT_ERROR if no file with the given name is found.
  */
-void fs_find(const char* name);
+void fs_find(const char* name, size_t len);
 
 #endif
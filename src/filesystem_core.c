@@ -19,46 +19,291 @@
  */
 
 #include <stdlib.h>
+#include <limits.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
+#if !defined(FS_LINEAR_TABLE) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 #include "utils.h"
 #include "hash.h"
+#include "names.h"
+#include "contents.h"
+#include "pool.h"
 #include "filesystem_core.h"
-
 /****************************************************
  *                      PRIVATE                     *
  ****************************************************/
 
-static fs_file_t* const FS_DELETED        = (fs_file_t*) -1;
-static float      const FS_TABLE_MAX_LOAD = 2.0 / 3.0;
+#if defined(FS_DIRECTORY_INDEX) && defined(FS_INCREMENTAL_RESIZE)
+#error "FS_INCREMENTAL_RESIZE only applies to the global table and can't be used with FS_DIRECTORY_INDEX"
+#endif
+
+/* Must be a power of two: hashes are reduced to table indexes by masking. */
+#ifndef FS_TABLE_INIT_SIZE
+#ifdef FS_DIRECTORY_INDEX
+#define FS_TABLE_INIT_SIZE 16
+#else
+#define FS_TABLE_INIT_SIZE (1024 * 1024 / sizeof(fs_file_t*))
+#endif
+#endif
+
+#ifndef FS_TABLE_RESIZE_STEP
+#define FS_TABLE_RESIZE_STEP 16
+#endif
+
+#ifndef FS_TABLE_MAX_LOAD
+#define FS_TABLE_MAX_LOAD (2.0 / 3.0)
+#endif
+
+#ifndef FS_TABLE_MIN_LOAD
+#define FS_TABLE_MIN_LOAD (1.0 / 8.0)
+#endif
+
+#ifndef FS_TABLE_MAX_DELETED
+#define FS_TABLE_MAX_DELETED (1.0 / 4.0)
+#endif
+
+#ifndef FS_ALL_INIT_SIZE
+#define FS_ALL_INIT_SIZE 16
+#endif
+
+#ifndef FS_SWEEP_STEP
+#define FS_SWEEP_STEP 64
+#endif
+
+/* A buffer is kept for a shorter content as long as at least this fraction of it is used. */
+#ifndef FS_DATA_MIN_USE
+#define FS_DATA_MIN_USE (1.0 / 2.0)
+#endif
+
 static size_t     const FS_ROOT_HASH      = 0;
 static size_t     const FS_HASH_ERROR     = (size_t) -1;
 
+#ifdef FS_LINEAR_TABLE
+#ifdef FS_INDEX_LINKS
+static fs_ref_t   const FS_DELETED        = (fs_ref_t) -1;
+#else
+static fs_ref_t   const FS_DELETED        = (fs_file_t*) -1;
+#endif
+#else
+#define FS_GROUP_SIZE 16
+
+static unsigned char const FS_CTRL_EMPTY   = 0x80;
+static unsigned char const FS_CTRL_DELETED = 0xfe;
+#endif
+
+#if MAX_FILESYSTEM_DEPTH > UCHAR_MAX
+#error "MAX_FILESYSTEM_DEPTH doesn't fit in fs_file_t.depth"
+#endif
+
+#ifdef FS_INCREMENTAL_RESIZE
+static fs_table_t fs_old_table;
+static size_t     fs_old_table_next;
+#endif
+
+#ifdef FS_LAZY_DELETE
+/* Detached subtrees waiting to be freed, linked by the right sibling of their roots, and the file the sweep will go on from. */
+static fs_ref_t   fs_dead  = FS_NIL;
+static fs_ref_t   fs_sweep = FS_NIL;
+#endif
+
+/* Chunks start on a cache line. Only the 32-byte hot parts of FS_HOT_COLD_SPLIT (without FS_DIRECTORY_INDEX) divide it evenly so that none of them crosses one: whole files (88 bytes in the default build) follow each other at any offset, and 3 in 8 of their hot parts cross a line. */
+#define FS_STORE_ALIGN 64
+
+/* Files are allocated in chunks of FS_STORE_CHUNK files (with FS_HOT_COLD_SPLIT, their hot parts followed by their cold parts), and recycled through a list of free ones linked by their parent. */
+#ifdef FS_HOT_COLD_SPLIT
+#define FS_STORE_RECORD (sizeof(fs_file_t) + sizeof(fs_cold_t))
+#else
+#define FS_STORE_RECORD sizeof(fs_file_t)
+#endif
+
+/* With FS_INDEX_LINKS, the first id is skipped so that 0 can mean no file, and the last one is FS_DELETED. */
+#ifdef FS_INDEX_LINKS
+#define FS_STORE_FIRST_ID 1
+#else
+#define FS_STORE_FIRST_ID 0
+#endif
+
+static void**      fs_store_mem;
+static size_t      fs_store_chunks;
+static size_t      fs_store_size;
+static uint32_t    fs_store_next = FS_STORE_FIRST_ID;
+static fs_ref_t    fs_store_free = FS_NIL;
+
+#ifdef FS_DIRECTORY_INDEX
+/* The tables of children of directories are packed in chunks and recycled, instead of being allocated one by one. */
+static pool_t fs_tables;
+#endif
+
+/**
+ * Get a new file from the store, reusing the last one deleted if any, and allocating a new chunk if needed.
+ * @ret   a pointer to a new uninitialized file (except for its id, with FS_HOT_COLD_SPLIT or FS_INDEX_LINKS).
+ */
+static fs_file_t* store_alloc(void) {
+	fs_file_t* file;
+	char* mem;
+
+	if (fs_store_free != FS_NIL) {
+		file          = fs__file(fs_store_free);
+		fs_store_free = file->parent;
+		return file;
+	}
+
+	if ((fs_store_next >> FS_STORE_CHUNK_BITS) == fs_store_chunks) {
+#ifdef FS_FILE_IDS
+		if (fs_store_next > UINT32_MAX - FS_STORE_CHUNK)
+			exit(1);
+#endif
+
+		if (fs_store_chunks == fs_store_size) {
+			fs_store_size = fs_store_size > 0 ? fs_store_size * 2 : 16;
+			fs_store_mem  = realloc_or_die(fs_store_mem, sizeof(void*) * fs_store_size);
+			fs_hot        = realloc_or_die(fs_hot, sizeof(fs_file_t*) * fs_store_size);
+#ifdef FS_HOT_COLD_SPLIT
+			fs_cold       = realloc_or_die(fs_cold, sizeof(fs_cold_t*) * fs_store_size);
+#endif
+		}
+
+		mem = malloc_or_die(FS_STORE_ALIGN + FS_STORE_RECORD * FS_STORE_CHUNK);
+		fs_store_mem[fs_store_chunks] = mem;
+		fs_hot[fs_store_chunks]       = (fs_file_t*)(mem + FS_STORE_ALIGN - (uintptr_t)mem % FS_STORE_ALIGN);
+#ifdef FS_HOT_COLD_SPLIT
+		fs_cold[fs_store_chunks]      = (fs_cold_t*)(fs_hot[fs_store_chunks] + FS_STORE_CHUNK);
+#endif
+		fs_store_chunks++;
+	}
+
+	file = fs_hot[fs_store_next >> FS_STORE_CHUNK_BITS] + (fs_store_next & (FS_STORE_CHUNK - 1));
+#ifdef FS_FILE_IDS
+	file->id = fs_store_next;
+#endif
+	fs_store_next++;
+
+	return file;
+}
+
+/**
+ * Give back a file to the store, so that the next store_alloc can reuse it (with the same id).
+ * @param file: the file to free.
+ */
+static inline void store_free(fs_file_t* file) {
+	file->parent  = fs_store_free;
+	fs_store_free = fs__ref(file);
+}
+
+/**
+ * Free all the chunks of the store at once, including the files still in use.
+ * @post  the store is empty.
+ */
+static void store_release(void) {
+	size_t i;
+
+	for (i = 0; i < fs_store_chunks; i++)
+		free(fs_store_mem[i]);
+
+	free(fs_store_mem);
+	free(fs_hot);
+#ifdef FS_HOT_COLD_SPLIT
+	free(fs_cold);
+	fs_cold         = NULL;
+#endif
+
+	fs_store_mem    = NULL;
+	fs_hot          = NULL;
+	fs_store_chunks = 0;
+	fs_store_size   = 0;
+	fs_store_next   = FS_STORE_FIRST_ID;
+	fs_store_free   = FS_NIL;
+}
+
+/**
+ * Allocate the cells of a table, all empty.
+ * @param size: the number of cells.
+ * @ret   an array of size cells, all FS_NIL.
+ */
+static inline fs_ref_t* table_cells(size_t size) {
+#ifdef FS_INDEX_LINKS
+	return calloc_or_die(size, sizeof(fs_ref_t));
+#else
+	return malloc_null(size, sizeof(fs_ref_t));
+#endif
+}
+
+#ifdef FS_LINEAR_TABLE
+/**
+ * Allocate an empty table.
+ * @param table: the table to initialize.
+ * @param size : the number of cells of the table.
+ */
+static void table_init(fs_table_t* table, size_t size) {
+	table->cells = table_cells(size);
+	table->files   = 0;
+	table->deleted = 0;
+	table->size    = size;
+}
+
 /**
- * Scan the table from a start index until a valid cell is found.
- * @param start : starting index.
- * @param key   : file name to match which was used as key to produce the initial hash.
+ * Destroy a table (but not the files it contains).
+ * @param table: the table to destroy.
+ * @post  table->cells is NULL.
+ */
+static void table_free(fs_table_t* table) {
+	free(table->cells);
+	table->cells = NULL;
+}
+
+/**
+ * Tell whether a cell of the table contains a file.
+ * @param table: the table.
+ * @param h    : index of the cell.
+ * @ret   true if the cell contains a file, false if it is empty or deleted.
+ */
+static inline bool table_used(const fs_table_t* table, size_t h) {
+	return table->cells[h] != FS_NIL && table->cells[h] != FS_DELETED;
+}
+
+/**
+ * Scan the table from the index given by the seed until a valid cell is found.
+ * @param table : the table to scan.
+ * @param seed  : the seed of the file, i.e. hash_combine(key->hash, parent->seed).
+ * @param key   : interned file name to match.
  * @param parent: file parent to match.
- * @param new   : whether to search for a new (empty) cell or an existing file.
- * @ret   index of the wanted cell in the table, FS_HASH_ERROR if it doesn't exist.
- * @pre   start has been created as start = hash(key, parent->hash, fs_table_size).
+ * @param new   : whether to search for a new (free) cell or an existing file.
+ * @ret   index of the wanted cell in the table (the first deleted cell, if any, when searching for a new one), FS_HASH_ERROR if it doesn't exist.
  */
-static size_t linear_probe(size_t start, const char* key, const fs_file_t* parent, bool new) {
+static size_t table_probe(const fs_table_t* table, uint64_t seed, const fs_name_t* key, const fs_file_t* parent, bool new) {
+	const fs_file_t* file;
+	fs_ref_t* cells;
+	fs_ref_t parent_ref;
 	register size_t h;
+	size_t free_h;
 
-	h = start;
+	cells      = table->cells;
+	parent_ref = fs__ref(parent);
+	h          = seed & (table->size - 1);
 
 	if (new) {
-		while (fs_table[h] != NULL && fs_table[h] != FS_DELETED) {
-			if (fs_table[h]->parent == parent && strcmp(fs_table[h]->name, key) == 0)
+		free_h = FS_HASH_ERROR;
+
+		while (cells[h] != FS_NIL) {
+			if (cells[h] == FS_DELETED) {
+				if (free_h == FS_HASH_ERROR)
+					free_h = h;
+			} else if ((file = fs__file(cells[h]))->parent == parent_ref && file->name == key) {
 				return FS_HASH_ERROR;
-			h = (h + 1) % fs_table_size;
+			}
+			h = (h + 1) & (table->size - 1);
 		}
+
+		if (free_h != FS_HASH_ERROR)
+			h = free_h;
 	} else {
-		while (fs_table[h] != NULL && (fs_table[h] == FS_DELETED || fs_table[h]->parent != parent || strcmp(fs_table[h]->name, key) != 0))
-			h = (h + 1) % fs_table_size;
+		while (cells[h] != FS_NIL && (cells[h] == FS_DELETED || (file = fs__file(cells[h]))->parent != parent_ref || file->name != key))
+			h = (h + 1) & (table->size - 1);
 
-		if (fs_table[h] == NULL)
+		if (cells[h] == FS_NIL)
 			return FS_HASH_ERROR;
 	}
 
@@ -66,225 +311,1199 @@ static size_t linear_probe(size_t start, const char* key, const fs_file_t* paren
 }
 
 /**
- * Rehash the files starting from cur and exploring the tree recursively.
- * @param cur: pointer to the file to rehash.
- * @pre   cur is a valid file pointer (not NULL) which was already properly removed from the table.
- * @post  cur->hash is the new hash and new position in the table.
+ * Put a file in a free cell of the table.
+ * @param table: the table.
+ * @param h    : index of the cell, as returned by table_probe.
+ * @param file : the file to insert.
+ */
+static inline void table_insert(fs_table_t* table, size_t h, fs_file_t* file) {
+	if (table->cells[h] == FS_DELETED)
+		table->deleted--;
+
+	table->cells[h] = fs__ref(file);
+	table->files++;
+}
+
+/**
+ * Insert a file in the first free cell of the table starting from the index given by its seed.
+ * @param table: the table.
+ * @param file : the file to insert.
+ * @pre   file is not already in the table.
+ */
+static void table_place(fs_table_t* table, fs_file_t* file) {
+	register size_t h;
+
+	h = file->seed & (table->size - 1);
+	while (table->cells[h] != FS_NIL && table->cells[h] != FS_DELETED)
+		h = (h + 1) & (table->size - 1);
+
+	table_insert(table, h, file);
+}
+
+/**
+ * Remove the file contained in a cell of the table.
+ * @param table: the table.
+ * @param h    : index of the cell.
+ * @post  the cell contains FS_DELETED, so that the probe sequences going through it stay intact.
+ */
+static inline void table_remove(fs_table_t* table, size_t h) {
+	table->cells[h] = FS_DELETED;
+	table->files--;
+	table->deleted++;
+}
+#else
+/**
+ * Compare a group of control bytes with the given one.
+ * @param ctrl: pointer to the first control byte of the group.
+ * @param c   : the control byte to match.
+ * @ret   a bit mask with the i-th bit set if ctrl[i] == c.
+ */
+static inline unsigned group_match(const unsigned char* ctrl, unsigned char c) {
+#ifdef __SSE2__
+	return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)ctrl), _mm_set1_epi8((char)c)));
+#else
+	unsigned mask;
+	int i;
+
+	mask = 0;
+	for (i = 0; i < FS_GROUP_SIZE; i++) {
+		if (ctrl[i] == c)
+			mask |= 1u << i;
+	}
+
+	return mask;
+#endif
+}
+
+/**
+ * Find the free (i.e. empty or deleted) cells of a group.
+ * @param ctrl: pointer to the first control byte of the group.
+ * @ret   a bit mask with the i-th bit set if the i-th cell of the group is free.
+ */
+static inline unsigned group_free(const unsigned char* ctrl) {
+#ifdef __SSE2__
+	return (unsigned)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)ctrl));
+#else
+	unsigned mask;
+	int i;
+
+	mask = 0;
+	for (i = 0; i < FS_GROUP_SIZE; i++) {
+		if (ctrl[i] & 0x80)
+			mask |= 1u << i;
+	}
+
+	return mask;
+#endif
+}
+
+/**
+ * Get the index of the lowest set bit of a (non zero) mask.
+ */
+static inline unsigned lowest_bit(unsigned mask) {
+#ifdef __GNUC__
+	return (unsigned)__builtin_ctz(mask);
+#else
+	unsigned i;
+
+	for (i = 0; !(mask & 1u); i++)
+		mask >>= 1;
+
+	return i;
+#endif
+}
+
+/**
+ * Get the index of the group a seed starts probing from, i.e. the high bits of the seed (the low 7 bits are used as tag).
+ */
+static inline size_t group_start(const fs_table_t* table, uint64_t seed) {
+	return (size_t)(seed >> 7) & (table->size - 1) & ~(size_t)(FS_GROUP_SIZE - 1);
+}
+
+/**
+ * Allocate an empty table.
+ * @param table: the table to initialize.
+ * @param size : the number of cells of the table.
+ * @pre   size is a power of two not smaller than FS_GROUP_SIZE.
+ */
+static void table_init(fs_table_t* table, size_t size) {
+	table->cells = table_cells(size);
+	table->ctrl  = malloc_or_die(size);
+	table->files   = 0;
+	table->deleted = 0;
+	table->size    = size;
+
+	memset(table->ctrl, FS_CTRL_EMPTY, size);
+}
+
+/**
+ * Destroy a table (but not the files it contains).
+ * @param table: the table to destroy.
+ * @post  table->cells is NULL.
+ */
+static void table_free(fs_table_t* table) {
+	free(table->cells);
+	free(table->ctrl);
+	table->cells = NULL;
+	table->ctrl  = NULL;
+}
+
+/**
+ * Tell whether a cell of the table contains a file.
+ * @param table: the table.
+ * @param h    : index of the cell.
+ * @ret   true if the cell contains a file, false if it is empty or deleted.
+ */
+static inline bool table_used(const fs_table_t* table, size_t h) {
+	return !(table->ctrl[h] & 0x80);
+}
+
+/**
+ * Scan the table one group of cells at a time starting from the group given by the seed, only looking at the files whose tag matches the low 7 bits of the seed, until a group with an empty cell is found.
+ * @param table : the table to scan.
+ * @param seed  : the seed of the file, i.e. hash_combine(key->hash, parent->seed).
+ * @param key   : interned file name to match.
+ * @param parent: file parent to match.
+ * @param new   : whether to search for a new (free) cell or an existing file.
+ * @ret   index of the wanted cell in the table, FS_HASH_ERROR if it doesn't exist.
+ */
+static size_t table_probe(const fs_table_t* table, uint64_t seed, const fs_name_t* key, const fs_file_t* parent, bool new) {
+	const unsigned char* ctrl;
+	const fs_file_t* file;
+	size_t g, step, h, free_h;
+	fs_ref_t parent_ref;
+	unsigned char tag;
+	unsigned match;
+
+	ctrl       = table->ctrl;
+	parent_ref = fs__ref(parent);
+	tag        = seed & 0x7f;
+	g          = group_start(table, seed);
+	free_h     = FS_HASH_ERROR;
+
+	for (step = FS_GROUP_SIZE;; step += FS_GROUP_SIZE) {
+		match = group_match(ctrl + g, tag);
+
+		while (match != 0) {
+			h    = g + lowest_bit(match);
+			file = fs__file(table->cells[h]);
+			if (file->parent == parent_ref && file->name == key)
+				return new ? FS_HASH_ERROR : h;
+			match &= match - 1;
+		}
+
+		if (new && free_h == FS_HASH_ERROR && (match = group_free(ctrl + g)) != 0)
+			free_h = g + lowest_bit(match);
+
+		if (group_match(ctrl + g, FS_CTRL_EMPTY) != 0)
+			return free_h;
+
+		g = (g + step) & (table->size - 1);
+	}
+}
+
+/**
+ * Put a file in a free cell of the table.
+ * @param table: the table.
+ * @param h    : index of the cell, as returned by table_probe.
+ * @param file : the file to insert.
+ */
+static inline void table_insert(fs_table_t* table, size_t h, fs_file_t* file) {
+	if (table->ctrl[h] == FS_CTRL_DELETED)
+		table->deleted--;
+
+	table->ctrl[h]  = file->seed & 0x7f;
+	table->cells[h] = fs__ref(file);
+	table->files++;
+}
+
+/**
+ * Insert a file in the first free cell of the table starting from the group given by its seed.
+ * @param table: the table.
+ * @param file : the file to insert.
+ * @pre   file is not already in the table.
+ */
+static void table_place(fs_table_t* table, fs_file_t* file) {
+	size_t g, step;
+	unsigned match;
+
+	g = group_start(table, file->seed);
+
+	for (step = FS_GROUP_SIZE; (match = group_free(table->ctrl + g)) == 0; step += FS_GROUP_SIZE)
+		g = (g + step) & (table->size - 1);
+
+	table_insert(table, g + lowest_bit(match), file);
+}
+
+/**
+ * Remove the file contained in a cell of the table.
+ * @param table: the table.
+ * @param h    : index of the cell.
+ * @post  the cell is marked as deleted, or directly as empty if its group already has an empty cell (which means that no probe sequence ever went past it).
+ */
+static inline void table_remove(fs_table_t* table, size_t h) {
+	if (group_match(table->ctrl + (h & ~(size_t)(FS_GROUP_SIZE - 1)), FS_CTRL_EMPTY) != 0) {
+		table->ctrl[h] = FS_CTRL_EMPTY;
+	} else {
+		table->ctrl[h] = FS_CTRL_DELETED;
+		table->deleted++;
+	}
+
+	table->cells[h] = FS_NIL;
+	table->files--;
+}
+#endif
+
+/**
+ * Get the table which contains the children of a directory: its own table if FS_DIRECTORY_INDEX is defined, the global one otherwise.
+ * @param parent: the directory.
+ * @ret   a pointer to the table, NULL if parent has its own table but no children.
+ */
+static inline fs_table_t* table_of(const fs_file_t* parent) {
+#ifdef FS_DIRECTORY_INDEX
+	return parent->children;
+#else
+	(void)parent;
+	return &fs_table;
+#endif
+}
+
+/**
+ * Find the table cell containing the file with the given name and parent, looking in the old table too if it is being moved.
+ * @param key   : interned file name to match.
+ * @param seed  : the seed of the file, i.e. hash_combine(key->hash, parent->seed).
+ * @param parent: file parent to match.
+ * @ret   a pointer to the file, NULL if it doesn't exist.
+ * @pre   parent has at least one child.
  */
-static void rehash_all(fs_file_t* cur) {
-	fs_file_t* child;
+static fs_file_t* lookup(const fs_name_t* key, uint64_t seed, const fs_file_t* parent) {
+	fs_table_t* table;
+	size_t h;
+
+	table = table_of(parent);
+	h     = table_probe(table, seed, key, parent, false);
+
+	if (h != FS_HASH_ERROR)
+		return fs__file(table->cells[h]);
+
+#ifdef FS_INCREMENTAL_RESIZE
+	if (fs_old_table.cells != NULL) {
+		h = table_probe(&fs_old_table, seed, key, parent, false);
 
-	if (cur->parent != NULL) {
-		cur->hash = hash(cur->name, cur->parent->hash, fs_table_size);
-		cur->hash = linear_probe(cur->hash, cur->name, cur->parent, true);
-		fs_table[cur->hash] = cur;
+		if (h != FS_HASH_ERROR)
+			return fs__file(fs_old_table.cells[h]);
 	}
+#endif
 
-	if (cur->is_dir) {
-		child = cur->content.l_child;
-		while (child != NULL) {
-			rehash_all(child);
-			child = child->r_sibling;
+	return NULL;
+}
+
+#ifdef FS_INCREMENTAL_RESIZE
+/**
+ * Move up to n cells of the old table to the current one, then destroy the old table if all its cells have been moved.
+ * @param n: maximum number of cells to move.
+ * @pre   fs_old_table.cells is not NULL.
+ */
+static void move_cells(size_t n) {
+	fs_file_t* cur;
+
+	while (n > 0 && fs_old_table_next < fs_old_table.size) {
+		if (table_used(&fs_old_table, fs_old_table_next)) {
+			cur = fs__file(fs_old_table.cells[fs_old_table_next]);
+			table_remove(&fs_old_table, fs_old_table_next);
+			table_place(&fs_table, cur);
 		}
+
+		fs_old_table_next++;
+		n--;
+	}
+
+	if (fs_old_table_next == fs_old_table.size)
+		table_free(&fs_old_table);
+}
+
+/**
+ * Keep the current table as the old one and allocate a new empty one with at least the given size; the files will be moved by move_cells a few at a time.
+ * @param table: the table to resize, i.e. &fs_table.
+ * @param size : the size of the new table.
+ * @pre   the old table isn't being moved anymore.
+ * @post  the table is empty, and large enough to take all the files plus the ones created until the move ends without going over FS_TABLE_MAX_LOAD.
+ */
+static void resize_table(fs_table_t* table, size_t size) {
+	/* No resize can start before the move ends, and at most one file is created for every FS_TABLE_RESIZE_STEP cells moved: the new table must have room for those too. */
+	while ((float)(table->files + table->size / FS_TABLE_RESIZE_STEP + 1) / (float)size > FS_TABLE_MAX_LOAD)
+		size *= 2;
+
+	fs_old_table      = *table;
+	fs_old_table_next = 0;
+	table_init(table, size);
+}
+#else
+/**
+ * Allocate a new table with the given size and move all the files there with a single scan of the current one, then destroy it.
+ * @param table: the table to resize.
+ * @param size : the size of the new table.
+ * @post  the table has the given size, contains all the files and no deleted cells.
+ */
+static void resize_table(fs_table_t* table, size_t size) {
+	fs_table_t old_table;
+	register size_t i;
+
+	old_table = *table;
+	table_init(table, size);
+
+	for (i = 0; i < old_table.size; i++) {
+		if (table_used(&old_table, i))
+			table_place(table, fs__file(old_table.cells[i]));
 	}
+
+	table_free(&old_table);
+}
+#endif
+
+/**
+ * Resize the table if needed: expand it if it is too full, shrink it if it is too empty, or rebuild it with the same size if too many of its cells are deleted.
+ * @param table: the table to fit.
+ * @ret   true if the table has been resized (and thus any index previously obtained is not valid anymore), false otherwise.
+ */
+static bool fit_table(fs_table_t* table) {
+	size_t files, size;
+
+#ifdef FS_INCREMENTAL_RESIZE
+	/* The new table already has enough room for the files created while the old one is being moved, and shrinking or cleaning it up waits until the move ends. */
+	if (fs_old_table.cells != NULL)
+		return false;
+#endif
+
+	files = table->files;
+	size  = table->size;
+
+	if ((float)files / (float)size > FS_TABLE_MAX_LOAD) {
+		resize_table(table, size * 2);
+		return true;
+	}
+
+	while (size > FS_TABLE_INIT_SIZE && (float)files / (float)size < FS_TABLE_MIN_LOAD)
+		size /= 2;
+
+	if (   size < table->size
+	    || (float)table->deleted / (float)size > FS_TABLE_MAX_DELETED
+	    || (float)(files + table->deleted) / (float)size > FS_TABLE_MAX_LOAD
+	) {
+		resize_table(table, size);
+		return true;
+	}
+
+	return false;
 }
 
 /**
- * Destroy the table and allocate a new one with double size, rehashing all the files.
- * @post fs_table_t is double its previous size and contains all the files, fs_table_size contains the new size.
+ * Tell whether a content is shared with other files through the table of contents, and thus can't be changed in place.
+ * @param data: the content.
+ * @ret   true if the content is interned (its capacity is 0), false otherwise or if FS_DEDUP_CONTENTS isn't defined.
  */
-static void expand_table(void) {
-	free(fs_table);
-	fs_table_size *= 2;
-	fs_table = malloc_null(fs_table_size, sizeof(fs_file_t*));
-	rehash_all(fs_root);
+static inline bool data_shared(const fs_data_t* data) {
+#ifdef FS_DEDUP_CONTENTS
+	return data->len > FS_DATA_INLINE && data->cap == 0;
+#else
+	(void)data;
+	return false;
+#endif
+}
+
+/**
+ * Free the buffer of a content stored outside the file, or release its reference if it is shared, if any.
+ * @param data: the content.
+ * @post  the content must be replaced before being used again.
+ */
+static inline void data_free(fs_data_t* data) {
+	if (data_shared(data))
+		content_release(content_of(data->buf.heap));
+	else if (data->len > FS_DATA_INLINE)
+		free(data->buf.heap);
+}
+
+/**
+ * Remove a file from the table and from the children of its parent.
+ * @param file: the file to unlink.
+ * @pre   file is not the root and, if it is a directory, it has no children (except when its subtree is being detached).
+ * @post  if FS_DIRECTORY_INDEX is defined and the parent of file has no more children, the table of the parent has been destroyed.
+ */
+static void unlink_file(fs_file_t* file) {
+	fs_file_t* parent;
+	fs_cold_t* cold;
+	size_t h;
+
+	parent = fs__file(file->parent);
+	cold   = fs__cold(file);
+
+	/* The index of the cell isn't stored in the file: it's found again with the same probe as a lookup. */
+#ifdef FS_INCREMENTAL_RESIZE
+	if (fs_old_table.cells != NULL && (h = table_probe(&fs_old_table, file->seed, file->name, parent, false)) != FS_HASH_ERROR)
+		table_remove(&fs_old_table, h);
+	else
+		table_remove(&fs_table, table_probe(&fs_table, file->seed, file->name, parent, false));
+#else
+	h = table_probe(table_of(parent), file->seed, file->name, parent, false);
+	table_remove(table_of(parent), h);
+#endif
+
+	if (cold->l_sibling != FS_NIL)
+		fs__cold(fs__file(cold->l_sibling))->r_sibling = cold->r_sibling;
+	else
+		fs__cold(parent)->content.l_child = cold->r_sibling;
+
+	if (cold->r_sibling != FS_NIL)
+		fs__cold(fs__file(cold->r_sibling))->l_sibling = cold->l_sibling;
+
+	parent->n_children--;
+
+#ifdef FS_DIRECTORY_INDEX
+	if (parent->n_children == 0) {
+		table_free(parent->children);
+		pool_free(&fs_tables, parent->children);
+		parent->children = NULL;
+	}
+#endif
+}
+
+/**
+ * Release a file which has already been unlinked from the tree, together with its content and its reference to its name.
+ * @param file: the file to free.
+ */
+static void free_file(fs_file_t* file) {
+	fs_cold_t* cold;
+
+	cold = fs__cold(file);
+
+#ifndef FS_NO_NAME_INDEX
+	if (cold->l_namesake != FS_NIL)
+		fs__cold(fs__file(cold->l_namesake))->r_namesake = cold->r_namesake;
+	else
+		file->name->files = fs__file(cold->r_namesake);
+
+	if (cold->r_namesake != FS_NIL)
+		fs__cold(fs__file(cold->r_namesake))->l_namesake = cold->l_namesake;
+#endif
+
+	if (!file->is_dir)
+		data_free(&cold->content.data);
+	name_release(file->name);
+
+	store_free(file);
+}
+
+/**
+ * Delete file and all the files contained in its subtree exploring it recursively, without resizing the table.
+ * @param file: the file to delete.
+ * @pre   file is not the root.
+ */
+static void del_tree(fs_file_t* file) {
+	if (file->is_dir) {
+		while (file->n_children > 0) {
+			del_tree(fs__file(fs__cold(file)->content.l_child));
+		}
+	}
+
+	unlink_file(file);
+	free_file(file);
+}
+
+#ifdef FS_LAZY_DELETE
+/**
+ * Free up to n files of the detached subtrees, leaves first, starting from where the previous call stopped.
+ * @param n: maximum number of files to free.
+ * @post  the root of a detached subtree is only freed after all its descendants, so that none of them can match a lookup from a new file allocated in its place.
+ */
+static void sweep(size_t n) {
+	fs_file_t *file, *parent;
+
+	while (n > 0 && fs_dead != FS_NIL) {
+		file = fs__file(fs_sweep != FS_NIL ? fs_sweep : fs_dead);
+
+		while (file->is_dir && file->n_children > 0)
+			file = fs__file(fs__cold(file)->content.l_child);
+
+		n--;
+
+		/* Detached roots have no parent: their cell and their link to the tree are already gone. */
+		if (file->parent == FS_NIL) {
+			fs_dead  = fs__cold(file)->r_sibling;
+			fs_sweep = FS_NIL;
+			free_file(file);
+			continue;
+		}
+
+		parent = fs__file(file->parent);
+		unlink_file(file);
+		free_file(file);
+
+		if (table_of(parent) != NULL)
+			fit_table(table_of(parent));
+
+		fs_sweep = fs__ref(parent);
+	}
+}
+
+#ifndef FS_NO_NAME_INDEX
+/**
+ * Tell whether a file is still in the tree or belongs to a detached subtree which hasn't been freed yet.
+ * @param file: the file to check.
+ * @ret   true if going up from file reaches the root, false otherwise.
+ */
+static bool is_live(const fs_file_t* file) {
+	while (file->parent != FS_NIL)
+		file = fs__file(file->parent);
+
+	return file == fs_root;
+}
+#endif
+#endif
+
+/**
+ * Free what the files of the whole tree own outside of the store (the contents of the files and the cells of the tables of children), visiting it in depth-first order without recursion and without unlinking anything.
+ * @param root: the root of the tree.
+ * @post  the files themselves are still allocated, and can only be released all together with the store.
+ */
+static void free_tree(fs_file_t* root) {
+	fs_file_t* file;
+	fs_cold_t* cold;
+
+	file = root;
+
+	for (;;) {
+		cold = fs__cold(file);
+
+		/* Shared contents are freed all together with the table of contents. */
+		if (!file->is_dir && !data_shared(&cold->content.data))
+			data_free(&cold->content.data);
+#ifdef FS_DIRECTORY_INDEX
+		else if (file->children != NULL)
+			table_free(file->children);
+#endif
+
+		if (file->is_dir && file->n_children > 0) {
+			file = fs__file(cold->content.l_child);
+			continue;
+		}
+
+		while (file != root && fs__cold(file)->r_sibling == FS_NIL)
+			file = fs__file(file->parent);
+
+		if (file == root)
+			break;
+
+		file = fs__file(fs__cold(file)->r_sibling);
+	}
+}
+
+/**
+ * Search all the files with the given interned name in the subtree of cur, visiting it in depth-first order without recursion by following the child, sibling and parent references.
+ * @param cur : pointer to the file from which the search will start.
+ * @param name: the interned name to search.
+ * @param n   : reference to a counter where the number of matches will be stored.
+ * @ret   an array of pointers to the matching files, grown by doubling its size.
+ */
+static fs_file_t** all_tree(fs_file_t* cur, const fs_name_t* name, size_t* n) {
+	fs_file_t **matches, *file;
+	size_t matches_size;
+
+	matches      = NULL;
+	matches_size = 0;
+	*n           = 0;
+	file         = cur;
+
+	for (;;) {
+		if (file->name == name) {
+			if (*n == matches_size) {
+				matches_size = matches_size > 0 ? matches_size * 2 : FS_ALL_INIT_SIZE;
+				matches      = realloc_or_die(matches, sizeof(fs_file_t*) * matches_size);
+			}
+
+			matches[(*n)++] = file;
+		}
+
+		if (file->is_dir && file->n_children > 0) {
+			file = fs__file(fs__cold(file)->content.l_child);
+			continue;
+		}
+
+		while (file != cur && fs__cold(file)->r_sibling == FS_NIL)
+			file = fs__file(file->parent);
+
+		if (file == cur)
+			break;
+
+		file = fs__file(fs__cold(file)->r_sibling);
+	}
+
+	return matches;
+}
+
+/**
+ * A file of the tree of the matches of a search: either a match or an ancestor of one, linked to its parent's other children in the same tree.
+ */
+typedef struct sort_node_s {
+	const fs_file_t* file;
+	size_t child;
+	size_t sibling;
+	bool match;
+} sort_node_t;
+
+/**
+ * An entry to order among the children of a directory: either one of them (if it matches) or its whole subtree, which sorts as if its name were followed by '/'.
+ */
+typedef struct sort_entry_s {
+	const sort_node_t* node;
+	bool subtree;
+} sort_entry_t;
+
+typedef struct sort_tree_s {
+	sort_node_t* nodes;
+	size_t n_nodes;
+	size_t size;
+	size_t* slots;
+	size_t n_slots;
+	sort_entry_t* entries;
+	fs_file_t** out;
+	size_t n_out;
+} sort_tree_t;
+
+static size_t const SORT_NONE = (size_t) -1;
+
+/**
+ * Get the slot of the map of a sort tree which contains the given file, or the empty slot where it should be inserted.
+ */
+static size_t sort_slot(const sort_tree_t* tree, const fs_file_t* file) {
+	register size_t i;
+
+	i = hash_combine((uint64_t)(uintptr_t)file, 0) & (tree->n_slots - 1);
+	while (tree->slots[i] != SORT_NONE && tree->nodes[tree->slots[i]].file != file)
+		i = (i + 1) & (tree->n_slots - 1);
+
+	return i;
+}
+
+/**
+ * Add a file to a sort tree as the first child of the given node, growing the tree if needed.
+ * @ret   the index of the new node.
+ */
+static size_t sort_add(sort_tree_t* tree, const fs_file_t* file, size_t parent) {
+	size_t i, new;
+
+	if (tree->n_nodes == tree->size) {
+		tree->size  *= 2;
+		tree->nodes  = realloc_or_die(tree->nodes, sizeof(sort_node_t) * tree->size);
+
+		free(tree->slots);
+		tree->n_slots *= 2;
+		tree->slots    = malloc_or_die(sizeof(size_t) * tree->n_slots);
+		memset(tree->slots, 0xff, sizeof(size_t) * tree->n_slots);
+
+		for (i = 0; i < tree->n_nodes; i++)
+			tree->slots[sort_slot(tree, tree->nodes[i].file)] = i;
+	}
+
+	new = tree->n_nodes++;
+	tree->nodes[new].file    = file;
+	tree->nodes[new].child   = SORT_NONE;
+	tree->nodes[new].sibling = SORT_NONE;
+	tree->nodes[new].match   = false;
+	tree->slots[sort_slot(tree, file)] = new;
+
+	if (parent != SORT_NONE) {
+		tree->nodes[new].sibling   = tree->nodes[parent].child;
+		tree->nodes[parent].child  = new;
+	}
+
+	return new;
+}
+
+/**
+ * Compare two sort entries as strcmp would compare the paths they contain.
+ */
+static int sort_cmp(const void* a, const void* b) {
+	const sort_entry_t *ea, *eb;
+	const fs_name_t *na, *nb;
+	int ca, cb, c;
+	size_t len;
+
+	ea  = a;
+	eb  = b;
+	na  = ea->node->file->name;
+	nb  = eb->node->file->name;
+	len = na->entry.len < nb->entry.len ? na->entry.len : nb->entry.len;
+	c   = memcmp(na->str, nb->str, len);
+
+	if (c != 0)
+		return c;
+
+	ca = na->entry.len > len ? (unsigned char)na->str[len] : ea->subtree ? '/' : -1;
+	cb = nb->entry.len > len ? (unsigned char)nb->str[len] : eb->subtree ? '/' : -1;
+
+	return ca - cb;
+}
+
+/**
+ * Append the matches contained in the subtree of a node of a sort tree to the output, in lexicographic order of their paths, sorting the children of each directory locally.
+ * @param tree : the sort tree.
+ * @param node : index of the node.
+ * @param first: index of the first free entry of tree->entries.
+ */
+static void sort_emit(sort_tree_t* tree, size_t node, size_t first) {
+	size_t child, last, i;
+
+	for (last = first, child = tree->nodes[node].child; child != SORT_NONE; child = tree->nodes[child].sibling) {
+		if (tree->nodes[child].match) {
+			tree->entries[last].node    = tree->nodes + child;
+			tree->entries[last].subtree = false;
+			last++;
+		}
+
+		if (tree->nodes[child].child != SORT_NONE) {
+			tree->entries[last].node    = tree->nodes + child;
+			tree->entries[last].subtree = true;
+			last++;
+		}
+	}
+
+	qsort(tree->entries + first, last - first, sizeof(sort_entry_t), sort_cmp);
+
+	for (i = first; i < last; i++) {
+		if (tree->entries[i].subtree)
+			sort_emit(tree, (size_t)(tree->entries[i].node - tree->nodes), last);
+		else
+			tree->out[tree->n_out++] = (fs_file_t*)tree->entries[i].node->file;
+	}
+}
+
+/**
+ * Sort files by path without building any path: build the tree made of the files and all their ancestors up to cur (visiting each shared ancestor only once), then visit it sorting the children of each directory by name.
+ * @param cur  : the common ancestor of all the files.
+ * @param files: array of files, which will be sorted in place.
+ * @param n    : number of files.
+ * @pre   all the files are in the subtree of cur and are distinct.
+ */
+static void sort_files(const fs_file_t* cur, fs_file_t** files, size_t n) {
+	const fs_file_t *stack[MAX_FILESYSTEM_DEPTH + 1], *file;
+	sort_tree_t tree;
+	size_t i, top, node;
+
+	tree.size    = 2 * n;
+	tree.n_nodes = 0;
+	tree.nodes   = malloc_or_die(sizeof(sort_node_t) * tree.size);
+	tree.n_slots = 4 * n;
+	for (i = 1; i < tree.n_slots; i *= 2);
+	tree.n_slots = i;
+	tree.slots   = malloc_or_die(sizeof(size_t) * tree.n_slots);
+	memset(tree.slots, 0xff, sizeof(size_t) * tree.n_slots);
+
+	sort_add(&tree, cur, SORT_NONE);
+
+	for (i = 0; i < n; i++) {
+		top = 0;
+		for (file = files[i]; (node = tree.slots[sort_slot(&tree, file)]) == SORT_NONE; file = fs__file(file->parent))
+			stack[top++] = file;
+
+		while (top > 0)
+			node = sort_add(&tree, stack[--top], node);
+
+		tree.nodes[node].match = true;
+	}
+
+	tree.entries = malloc_or_die(sizeof(sort_entry_t) * 2 * tree.n_nodes);
+	tree.out     = files;
+	tree.n_out   = 0;
+
+	if (tree.nodes[0].match)
+		tree.out[tree.n_out++] = (fs_file_t*)cur;
+
+	sort_emit(&tree, 0, 0);
+
+	free(tree.entries);
+	free(tree.slots);
+	free(tree.nodes);
 }
 
 /****************************************************
  *                      PUBLIC                      *
  ****************************************************/
 
+#ifndef FS_DIRECTORY_INDEX
+fs_table_t fs_table;
+#endif
+fs_file_t* fs_root;
+fs_file_t** fs_hot;
+#ifdef FS_HOT_COLD_SPLIT
+fs_cold_t** fs_cold;
+#endif
+
 inline void fs__init(void) {
-	fs_table_files = 0;
-	fs_table_size  = 1024 * 1024 / sizeof(fs_file_t*);
-	fs_table       = malloc_null(fs_table_size, sizeof(fs_file_t*));
-	fs_root        = fs__new((size_t*)&FS_ROOT_HASH, "", true, NULL);
+#ifdef FS_DIRECTORY_INDEX
+	pool_init(&fs_tables, sizeof(fs_table_t));
+#endif
+	names_init();
+#ifdef FS_DEDUP_CONTENTS
+	contents_init();
+#endif
+#ifndef FS_DIRECTORY_INDEX
+	table_init(&fs_table, FS_TABLE_INIT_SIZE);
+#endif
+	fs_root = fs__new((size_t*)&FS_ROOT_HASH, hash_random_seed(), name_intern("", 0), true, NULL);
 }
 
 inline void fs__exit(void) {
-	while (fs_root->content.l_child != NULL)
-		fs__del(&fs_root->content.l_child);
+	/* Nothing needs to be unlinked: files, tables of children and names are all released at once with their chunks. */
+	free_tree(fs_root);
+#ifdef FS_LAZY_DELETE
+	for (; fs_dead != FS_NIL; fs_dead = fs__cold(fs__file(fs_dead))->r_sibling)
+		free_tree(fs__file(fs_dead));
+#endif
+	store_release();
+#ifdef FS_DIRECTORY_INDEX
+	pool_release(&fs_tables);
+#else
+	table_free(&fs_table);
+#endif
 
-	free(fs_root);
-	free(fs_table);
+#ifdef FS_INCREMENTAL_RESIZE
+	if (fs_old_table.cells != NULL)
+		table_free(&fs_old_table);
+#endif
+
+#ifdef FS_DEDUP_CONTENTS
+	contents_exit();
+#endif
+	names_exit();
 }
 
-fs_file_t* fs__new(size_t* new_hash, char* new_name, bool is_dir, fs_file_t* parent) {
+fs_file_t* fs__new(size_t* new_hash, uint64_t new_seed, fs_name_t* new_name, bool is_dir, fs_file_t* parent) {
 	fs_file_t* new;
+	fs_cold_t* cold;
 
-	if (((float)fs_table_files / (float)fs_table_size) > FS_TABLE_MAX_LOAD) {
-		expand_table();
-		*new_hash = hash(new_name, parent->hash, fs_table_size);
-		*new_hash = linear_probe(*new_hash, new_name, parent, true);
-	}
+	if (parent != NULL && fit_table(table_of(parent)))
+		*new_hash = table_probe(table_of(parent), new_seed, new_name, parent, true);
 
-	new             = malloc_or_die(sizeof(fs_file_t));
-	new->name       = malloc_or_die(strlen(new_name) + 1);
-	new->hash       = *new_hash;
+	new             = store_alloc();
+	cold            = fs__cold(new);
+	new->name       = new_name;
+	new->seed       = new_seed;
 	new->is_dir     = is_dir;
+	new->depth      = parent == NULL ? 0 : parent->depth + 1;
 	new->n_children = 0;
-	new->parent     = parent;
-	new->l_sibling  = NULL;
+	new->parent     = fs__ref(parent);
+#ifdef FS_DIRECTORY_INDEX
+	new->children   = NULL;
+#endif
+	cold->path_len  = parent == NULL ? 0 : fs__cold(parent)->path_len + 1 + new_name->entry.len;
+	cold->l_sibling = FS_NIL;
+#ifndef FS_NO_NAME_INDEX
+	cold->l_namesake = FS_NIL;
+	cold->r_namesake = fs__ref(new_name->files);
+	if (cold->r_namesake != FS_NIL)
+		fs__cold(new_name->files)->l_namesake = fs__ref(new);
 
-	strcpy(new->name, new_name);
+	new_name->files = new;
+#endif
 
-	if (is_dir)
-		new->content.l_child = NULL;
-	else
-		new->content.data = calloc_or_die(1, sizeof(char));
+	if (is_dir) {
+		cold->content.l_child = FS_NIL;
+	} else {
+		cold->content.data.len        = 0;
+		cold->content.data.buf.str[0] = '\0';
+	}
 
 	if (parent == NULL) {
-		new->r_sibling = NULL;
+		cold->r_sibling = FS_NIL;
 	} else {
-		new->r_sibling = parent->content.l_child;
-		if (new->r_sibling != NULL)
-			new->r_sibling->l_sibling = new;
+		cold->r_sibling = fs__cold(parent)->content.l_child;
+		if (cold->r_sibling != FS_NIL)
+			fs__cold(fs__file(cold->r_sibling))->l_sibling = fs__ref(new);
 
-		parent->content.l_child = new;
+		fs__cold(parent)->content.l_child = fs__ref(new);
 		parent->n_children++;
 	}
 
 	return new;
 }
 
-fs_file_t** fs__get(char* path, bool new, bool new_is_dir) {
-	fs_file_t *new_file, *parent;
-	register unsigned short depth;
-	char *cur_name, *next_name;
-	size_t cur_hash;
+fs_file_t* fs__get(const fs_path_t* path, bool new, bool new_is_dir) {
+	fs_file_t *new_file, *parent, *file;
+	const fs_path_name_t* cur_name;
+	fs_name_t* name;
+	fs_table_t* table;
+	uint64_t cur_seed;
+	size_t cur_hash, i;
+
+#ifdef FS_INCREMENTAL_RESIZE
+	if (fs_old_table.cells != NULL)
+		move_cells(FS_TABLE_RESIZE_STEP);
+#endif
+#ifdef FS_LAZY_DELETE
+	sweep(FS_SWEEP_STEP);
+#endif
 
-	depth     = 0;
-	parent    = fs_root;
-	cur_name  = strtok(path, "/");
-	next_name = strtok(NULL, "/");
-	cur_hash  = FS_ROOT_HASH;
+	if (path->depth == 0)
+		return NULL;
+
+	parent = fs_root;
 
-	while (next_name != NULL) {
+	for (i = 0; i + 1 < path->depth; i++) {
 		if (parent->n_children == 0)
 			return NULL;
 
-		cur_hash = hash(cur_name, parent->hash, fs_table_size);
-		cur_hash = linear_probe(cur_hash, cur_name, parent, false);
+		name = name_find(path->names[i].str, path->names[i].len);
+
+		if (name == NULL)
+			return NULL;
+
+		file = lookup(name, hash_combine(name->entry.hash, parent->seed), parent);
 
-		if (cur_hash == FS_HASH_ERROR)
+		if (file == NULL)
 			return NULL;
 
-		depth++;
-		parent    = fs_table[cur_hash];
-		cur_name  = next_name;
-		next_name = strtok(NULL, "/");
+		parent = file;
 	}
 
-	if (   cur_name == NULL
-	    || !parent->is_dir
-	    || !((new && parent->n_children < MAX_DIRECTORY_CHILDREN && depth < MAX_FILESYSTEM_DEPTH) || (!new && parent->n_children > 0))
+	cur_name = path->names + path->depth - 1;
+
+	if (   !parent->is_dir
+	    || !((new && parent->n_children < MAX_DIRECTORY_CHILDREN && parent->depth < MAX_FILESYSTEM_DEPTH) || (!new && parent->n_children > 0))
 	)
 		return NULL;
 
-	cur_hash = hash(cur_name, parent->hash, fs_table_size);
-	cur_hash = linear_probe(cur_hash, cur_name, parent, new);
+	if (!new) {
+		name = name_find(cur_name->str, cur_name->len);
 
-	if (cur_hash == FS_HASH_ERROR)
+		if (name == NULL)
+			return NULL;
+
+		return lookup(name, hash_combine(name->entry.hash, parent->seed), parent);
+	}
+
+	name     = name_intern(cur_name->str, cur_name->len);
+	cur_seed = hash_combine(name->entry.hash, parent->seed);
+
+#ifdef FS_INCREMENTAL_RESIZE
+	if (fs_old_table.cells != NULL && table_probe(&fs_old_table, cur_seed, name, parent, false) != FS_HASH_ERROR) {
+		name_release(name);
 		return NULL;
+	}
+#endif
 
-	if (new) {
-		new_file = fs__new(&cur_hash, cur_name, new_is_dir, parent);
-		fs_table[cur_hash] = new_file;
-		fs_table_files++;
+#ifdef FS_DIRECTORY_INDEX
+	if (parent->children == NULL) {
+		parent->children = pool_alloc(&fs_tables);
+		table_init(parent->children, FS_TABLE_INIT_SIZE);
 	}
+#endif
 
-	return fs_table + cur_hash;
+	table    = table_of(parent);
+	cur_hash = table_probe(table, cur_seed, name, parent, true);
+
+	if (cur_hash == FS_HASH_ERROR) {
+		name_release(name);
+		return NULL;
+	}
+
+	new_file = fs__new(&cur_hash, cur_seed, name, new_is_dir, parent);
+	table_insert(table, cur_hash, new_file);
+
+	return new_file;
 }
 
-fs_file_t** fs__all(fs_file_t* cur, const char* name, size_t* n) {
-	fs_file_t **matches, **sub_matches, *child;
-	size_t matches_size, sub_n;
-	register size_t sub_i;
+fs_file_t** fs__all(fs_file_t* cur, const char* name, size_t len, size_t* n) {
+	fs_file_t** matches;
+	fs_name_t* interned;
+#ifndef FS_NO_NAME_INDEX
+	fs_file_t* file;
+#endif
 
-	matches      = NULL;
-	matches_size = 0;
-	*n           = 0;
+#ifdef FS_LAZY_DELETE
+	sweep(FS_SWEEP_STEP);
+#endif
 
-	if (strcmp(cur->name, name) == 0) {
-		matches_size = 1;
-		matches      = malloc_or_die(sizeof(fs_file_t*));
-		matches[*n]  = cur;
-		(*n)++;
-	}
+	*n       = 0;
+	interned = name_find(name, len);
 
-	if (cur->is_dir && cur->n_children > 0) {
-		child = cur->content.l_child;
-		while (child != NULL) {
-			sub_n       = 0;
-			sub_matches = fs__all(child, name, &sub_n);
+	if (interned == NULL)
+		return NULL;
 
-			if (sub_n > 0) {
-				matches_size += sub_n;
-				matches       = realloc_or_die(matches, sizeof(fs_file_t*) * matches_size);
+#ifndef FS_NO_NAME_INDEX
+	/* The list of files with the name spans the whole tree, so it can only replace the exploration when starting from the root. */
+	if (cur == fs_root) {
+		matches = malloc_or_die(sizeof(fs_file_t*) * interned->entry.refs);
 
-				for (sub_i = 0; sub_i < sub_n; sub_i++, (*n)++)
-					matches[*n] = sub_matches[sub_i];
-			}
+		for (file = interned->files; file != NULL; file = fs__file(fs__cold(file)->r_namesake)) {
+#ifdef FS_LAZY_DELETE
+			/* The list also has the files of detached subtrees until they are swept. */
+			if (fs_dead != FS_NIL && !is_live(file))
+				continue;
+#endif
+			matches[(*n)++] = file;
+		}
 
-			free(sub_matches);
-			child = child->r_sibling;
+		if (*n == 0) {
+			free(matches);
+			return NULL;
 		}
+	} else
+#endif
+	{
+		matches = all_tree(cur, interned, n);
 	}
 
+	if (*n > 1)
+		sort_files(cur, matches, *n);
+
 	return matches;
 }
 
-char* fs__uri(fs_file_t* cur, size_t len) {
-	char* path;
+void fs__path(char* path, const fs_file_t* cur, const fs_file_t* prev) {
+	const fs_file_t *stop, *file;
+	size_t end;
 
-	if (cur->parent == NULL) {
-		path = malloc_or_die(sizeof(char) * (len + 1));
-		path[0] = '\0';
-		return path;
+	if (prev == NULL) {
+		stop = NULL;
+	} else {
+		for (file = cur, stop = prev; file->depth > stop->depth; file = fs__file(file->parent));
+		for (; stop->depth > file->depth; stop = fs__file(stop->parent));
+		for (; file != stop; file = fs__file(file->parent), stop = fs__file(stop->parent));
 	}
 
-	path = fs__uri(cur->parent, len + strlen(cur->name) + 1);
-	strcat(path, "/");
-	strcat(path, cur->name);
+	/* Only the length of the whole path is needed: each name ends where the previous one (going right to left) started. */
+	end       = fs__cold(cur)->path_len;
+	path[end] = '\0';
 
-	return path;
+	for (file = cur; file != stop && file->parent != FS_NIL; file = fs__file(file->parent)) {
+		end -= file->name->entry.len;
+		memcpy(path + end, file->name->str, file->name->entry.len);
+		path[--end] = '/';
+	}
 }
 
-void fs__del(fs_file_t** cur) {
-	fs_file_t* next;
+const char* fs__data(const fs_file_t* file, size_t* len) {
+	const fs_data_t* data;
 
-	if ((*cur)->is_dir) {
-		while ((*cur)->content.l_child != NULL) {
-			fs__del(&(*cur)->content.l_child);
-		}
+	data = &fs__cold(file)->content.data;
+	*len = data->len;
+
+	return data->len > FS_DATA_INLINE ? data->buf.heap : data->buf.str;
+}
+
+void fs__write(fs_file_t* file, const char* data, size_t len) {
+	fs_data_t* content;
+	char* dst;
+
+	content = &fs__cold(file)->content.data;
+
+#ifdef FS_DEDUP_CONTENTS
+	/* Contents which don't fit in the file are always shared: the new one is taken before releasing the old one, which may be the same. */
+	if (len > FS_DATA_INLINE) {
+		dst = content_intern(data, len)->str;
+		data_free(content);
+
+		content->buf.heap = dst;
+		content->cap      = 0;
+		content->len      = len;
+		return;
+	}
+#endif
+
+	if (len <= FS_DATA_INLINE) {
+		data_free(content);
+		dst = content->buf.str;
+	} else if (content->len > FS_DATA_INLINE && len <= content->cap && len >= content->cap * FS_DATA_MIN_USE) {
+		dst = content->buf.heap;
+	} else {
+		data_free(content);
+		dst = content->buf.heap = malloc_or_die(len + 1);
+		content->cap = len;
 	}
 
-	fs_table[(*cur)->hash] = FS_DELETED;
-	fs_table_files--;
+	memcpy(dst, data, len);
+	dst[len]     = '\0';
+	content->len = len;
+}
+
+bool fs__append(fs_file_t* file, const char* data, size_t len) {
+	fs_data_t* content;
+	size_t new_len, new_cap;
+	char* dst;
+
+	content = &fs__cold(file)->content.data;
+	new_len = content->len + len;
+
+	if (new_len >= UINT32_MAX)
+		return false;
+
+	if (new_len <= FS_DATA_INLINE) {
+		dst = content->buf.str;
+	} else if (content->len > FS_DATA_INLINE && !data_shared(content)) {
+		/* The buffer grows geometrically, so that a sequence of appends costs as much as copying the data once (plus a constant factor). */
+		if (new_len > content->cap) {
+			new_cap = content->cap * 2;
+			if (new_cap < new_len)
+				new_cap = new_len;
+			if (new_cap >= UINT32_MAX)
+				new_cap = UINT32_MAX - 1;
+
+			content->buf.heap = realloc_or_die(content->buf.heap, new_cap + 1);
+			content->cap      = new_cap;
+		}
+
+		dst = content->buf.heap;
+	} else {
+		/* Inline and shared contents move to a new buffer of their own. */
+		new_cap = content->len * 2 > new_len ? content->len * 2 : new_len;
+		if (new_cap >= UINT32_MAX)
+			new_cap = UINT32_MAX - 1;
 
-	(*cur)->parent->n_children--;
-	if (!(*cur)->is_dir)
-		free((*cur)->content.data);
-	free((*cur)->name);
+		dst = malloc_or_die(new_cap + 1);
+		memcpy(dst, content->len > FS_DATA_INLINE ? content->buf.heap : content->buf.str, content->len);
+		data_free(content);
 
-	next = (*cur)->r_sibling;
-	if (next != NULL)
-		next->l_sibling = (*cur)->l_sibling;
+		content->buf.heap = dst;
+		content->cap      = new_cap;
+	}
+
+	memcpy(dst + content->len, data, len);
+	content->len += len;
+	dst[content->len] = '\0';
 
-	free(*cur);
-	*cur = next;
+	return true;
 }
 
-int fs__cmp(const void* a, const void* b) {
-	return strcmp(*(const char**)a, *(const char**)b);
+void fs__del(fs_file_t* cur) {
+	fs_file_t* parent;
+#ifdef FS_LAZY_DELETE
+	fs_cold_t* cold;
+#endif
+
+	parent = fs__file(cur->parent);
+
+#ifdef FS_LAZY_DELETE
+	/* Only the root of the subtree is unlinked now: its descendants can't be reached anymore, and are freed later by sweep. */
+	if (cur->is_dir && cur->n_children > 0) {
+		unlink_file(cur);
+		cold = fs__cold(cur);
+		cur->parent     = FS_NIL;
+		cold->l_sibling = FS_NIL;
+
+		/* The sweep may be in the middle of the first subtree of the list, so the new one goes after it. */
+		if (fs_dead == FS_NIL) {
+			cold->r_sibling = FS_NIL;
+			fs_dead         = fs__ref(cur);
+		} else {
+			cold->r_sibling = fs__cold(fs__file(fs_dead))->r_sibling;
+			fs__cold(fs__file(fs_dead))->r_sibling = fs__ref(cur);
+		}
+	} else
+#endif
+	{
+		del_tree(cur);
+	}
+
+	if (table_of(parent) != NULL)
+		fit_table(table_of(parent));
 }
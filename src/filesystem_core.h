@@ -21,99 +21,259 @@
 #ifndef API_PROJECT_FS_CORE_INCLUDED
 #define API_PROJECT_FS_CORE_INCLUDED
 
+#include <stdint.h>
+#include "names.h"
+
 #define MAX_FILESYSTEM_DEPTH 255
 #define MAX_DIRECTORY_CHILDREN 1024
 
+/* Files are stored in chunks of (1 << FS_STORE_CHUNK_BITS) files, which never move. */
+#ifndef FS_STORE_CHUNK_BITS
+#define FS_STORE_CHUNK_BITS 10
+#endif
+
+#define FS_STORE_CHUNK ((size_t)1 << FS_STORE_CHUNK_BITS)
+
+/* Contents up to this length are stored inside the file itself, in place of the pointer to a separate buffer. */
+#define FS_DATA_INLINE (sizeof(char*) - 1)
+
 typedef union  fs_file_content_u fs_file_content_t;
+typedef struct fs_data_s         fs_data_t;
 typedef struct fs_file_s         fs_file_t;
+typedef struct fs_cold_s         fs_cold_t;
+typedef struct fs_table_s        fs_table_t;
+typedef struct fs_path_name_s    fs_path_name_t;
+typedef struct fs_path_s         fs_path_t;
+
+#if defined(FS_HOT_COLD_SPLIT) || defined(FS_INDEX_LINKS)
+#define FS_FILE_IDS
+#endif
+
+#ifdef FS_INDEX_LINKS
+/* Files refer to each other (and the table refers to them) by their 32-bit id: id 0 is never used, so it can stand for no file. */
+typedef uint32_t fs_ref_t;
+#define FS_NIL ((fs_ref_t) 0)
+#else
+typedef fs_file_t* fs_ref_t;
+#define FS_NIL NULL
+#endif
+
+/**
+ * The content of a file: up to FS_DATA_INLINE characters it is stored in buf.str, otherwise buf.heap points to a separate buffer of cap + 1 characters (see fs__write), or inside an interned content shared with other files if cap is 0 (only with FS_DEDUP_CONTENTS).
+ */
+struct fs_data_s {
+	uint32_t len;
+	uint32_t cap;
+	union {
+		char* heap;
+		char str[sizeof(char*)];
+	} buf;
+};
 
 union fs_file_content_u {
-	fs_file_t* l_child;
-	char* data;
+	fs_ref_t l_child;
+	fs_data_t data;
 };
 
+/**
+ * The cold part of a file, only needed to change or walk the tree and to read or write contents: it follows the hot part, or with FS_HOT_COLD_SPLIT it is stored apart with the same id (see fs__cold).
+ */
+struct fs_cold_s {
+	fs_file_content_t content;
+	fs_ref_t l_sibling, r_sibling;
+#ifndef FS_NO_NAME_INDEX
+	fs_ref_t l_namesake, r_namesake;
+#endif
+	unsigned int path_len;
+};
+
+/**
+ * The hot part of a file, read at every step of a lookup, packed in its first 32 bytes (40 with FS_DIRECTORY_INDEX).
+ */
 struct fs_file_s {
-	size_t hash;
-	char* name;
+	uint64_t seed;
+	fs_name_t* name;
+	fs_ref_t parent;
+#ifdef FS_DIRECTORY_INDEX
+	fs_table_t* children;
+#endif
+#ifdef FS_FILE_IDS
+	uint32_t id;
+#endif
 	bool is_dir;
+	unsigned char depth;
 	unsigned short n_children;
-	fs_file_content_t content;
-	fs_file_t *parent, *l_sibling, *r_sibling;
+#ifndef FS_HOT_COLD_SPLIT
+	fs_cold_t cold;
+#endif
+};
+
+/**
+ * A name of a path, pointing inside the string where the path was read (not NUL-terminated).
+ */
+struct fs_path_name_s {
+	const char* str;
+	size_t len;
 };
 
-fs_file_t** fs_table;
-fs_file_t*  fs_root;
-size_t      fs_table_files;
-size_t      fs_table_size;
+/**
+ * A path split in its names, stored wherever it was split: a path with no names, or with more than any existing file could have, is given a depth of 0 and refers to no file.
+ */
+struct fs_path_s {
+	size_t depth;
+	const fs_path_name_t* names;
+};
+
+struct fs_table_s {
+	fs_ref_t* cells;
+#ifndef FS_LINEAR_TABLE
+	unsigned char* ctrl;
+#endif
+	size_t files;
+	size_t deleted;
+	size_t size;
+};
+
+#ifndef FS_DIRECTORY_INDEX
+extern fs_table_t fs_table;
+#endif
+extern fs_file_t* fs_root;
+extern fs_file_t** fs_hot;
+#ifdef FS_HOT_COLD_SPLIT
+extern fs_cold_t** fs_cold;
+#endif
 
 /**
- * Initialize the hash table and create the root.
- * @post the hash table has been allocated in memory and the root has been created.
+ * Get the file a reference refers to.
+ * @param ref: the reference.
+ * @ret   a pointer to the file, NULL if ref is FS_NIL.
+ */
+static inline fs_file_t* fs__file(fs_ref_t ref) {
+#ifdef FS_INDEX_LINKS
+	return ref == FS_NIL ? NULL : fs_hot[ref >> FS_STORE_CHUNK_BITS] + (ref & (FS_STORE_CHUNK - 1));
+#else
+	return ref;
+#endif
+}
+
+/**
+ * Get a reference to a file.
+ * @param file: the file.
+ * @ret   the reference, FS_NIL if file is NULL.
+ */
+static inline fs_ref_t fs__ref(const fs_file_t* file) {
+#ifdef FS_INDEX_LINKS
+	return file == NULL ? FS_NIL : file->id;
+#else
+	return (fs_file_t*)file;
+#endif
+}
+
+/**
+ * Get the cold part of a file.
+ * @param file: the file.
+ * @ret   a pointer to the cold part of the file, which never moves until the file is deleted.
+ */
+static inline fs_cold_t* fs__cold(const fs_file_t* file) {
+#ifdef FS_HOT_COLD_SPLIT
+	return fs_cold[file->id >> FS_STORE_CHUNK_BITS] + (file->id & (FS_STORE_CHUNK - 1));
+#else
+	return (fs_cold_t*)&file->cold;
+#endif
+}
+
+/**
+ * Initialize the hash table and the table of names, and create the root.
+ * @post the hash table has been allocated in memory (unless FS_DIRECTORY_INDEX is defined, in which case each directory allocates its own table when its first child is created) and the root has been created.
  */
 void fs__init(void);
 
 /**
  * Destroy the whole filesystem tree (including root) and free all the space.
- * @post the whole filesystem tree and hashtable have been freed.
+ * @post the whole filesystem tree, hashtable and table of names have been freed.
  */
 void fs__exit(void);
 
 /**
- * Create a new file, initialize it according to the given parameters and insert it in the list of its parent's children; expand the hash table if necessary, calculating the updated hash.
+ * Create a new file, initialize it according to the given parameters and insert it in the list of its parent's children; resize the hash table containing the children of parent if necessary (or start resizing it, if FS_INCREMENTAL_RESIZE is defined), calculating the updated hash.
  * @param new_hash: pointer to the hash of the new file.
- * @param new_name: the name of the new file.
+ * @param new_seed: the seed of the new file, i.e. hash_combine(new_name->entry.hash, parent->seed), which never changes and is used to find both the file and its children.
+ * @param new_name: the interned name of the new file, whose reference is now owned by the file.
  * @param is_dir  : whether the new file is a directory or not.
  * @param parent  : a pointer to the new file's parent.
  * @ret   a pointer to the new file.
  * @pre   all the checks before the creation have already been made.
- * @post  the new file is now the head of the list of children starting at parent->content.l_child; if the hash table is expanded during the creation, *new_hash now contains the updated hash.
+ * @post  the new file is now the head of the list of children starting at fs__cold(parent)->content.l_child and of the list of files with its name (unless FS_NO_NAME_INDEX is defined); if the hash table is expanded during the creation, *new_hash now contains the updated hash.
  */
-fs_file_t* fs__new(size_t* new_hash, char* new_name, bool is_dir, fs_file_t* parent);
+fs_file_t* fs__new(size_t* new_hash, uint64_t new_seed, fs_name_t* new_name, bool is_dir, fs_file_t* parent);
 
 /**
- * Browse the filesystem following the path and return a pointer to the table cell identified by the path, creating a new file in such cell if requested.
- * @param path      : the path of the file to get.
+ * Browse the filesystem following the path and return the file identified by the path, creating it if requested.
+ * @param path      : the path of the file to get, already split in its names.
  * @param new       : whether the path refers to a new file or an already existing one.
  * @param new_is_dir: whether the new file is a directory or not.
- * @ret   a pointer to the requested table cell or NULL in case of an error (e.g. a folder in the path doesn't exist).
- * @post  if new is true, a new file is created in the table cell identified by the path.
+ * @ret   a pointer to the requested file or NULL in case of an error (e.g. a folder in the path doesn't exist).
+ * @post  if new is true, a new file is created in the table cell identified by the path; if FS_INCREMENTAL_RESIZE is defined and the table is being expanded, a bounded number of files has been moved to the new table.
  */
-fs_file_t** fs__get(char* path, bool new, bool new_is_dir);
+fs_file_t* fs__get(const fs_path_t* path, bool new, bool new_is_dir);
 
 /**
- * Search all the files with the given name starting from cur and exploring the tree recursively.
+ * Search all the files with the given name starting from cur: if cur is the root the list of files with such name is used directly (unless FS_NO_NAME_INDEX is defined), otherwise the subtree of cur is explored iteratively comparing interned names; if no file has such name the tree isn't explored at all.
  * @param cur : pointer to the file from which the search will start.
- * @param name: the name to search.
+ * @param name: the name to search (not necessarily NUL-terminated).
+ * @param len : the length of the name.
  * @param n   : reference to a counter where the number of matches will be stored.
- * @ret   an array of pointers to files which all have the same requested name.
+ * @ret   an array of pointers to files which all have the same requested name, sorted in lexicographic order of their paths (as strcmp would sort them), NULL if there are none.
  * @pre   cur is a valid file pointer (not NULL).
  */
-fs_file_t** fs__all(fs_file_t* cur, const char* name, size_t* n);
+fs_file_t** fs__all(fs_file_t* cur, const char* name, size_t len, size_t* n);
 
 /**
- * Trace the given file back until the root and return its full path.
- * @param cur: the file of which the path is requested.
- * @param len: the length of the path in characters, should be 0 (zero) for the first recursive call.
- * @ret   a string representing the full path to the file.
+ * Write the full path of the given file in a buffer, from right to left, tracing the file back until the root; if the buffer already contains the path of another file, stop at their deepest common ancestor instead, so that the shared part of the path isn't written again.
+ * @param path: the buffer, of at least cur->path_len + 1 characters.
+ * @param cur : the file of which the path is requested.
+ * @param prev: the file whose path is already contained in the buffer, NULL if none.
  * @pre   cur is a valid file pointer (not NULL).
+ * @post  path contains the NUL-terminated full path of cur.
  */
-char* fs__uri(fs_file_t* cur, size_t len);
+void fs__path(char* path, const fs_file_t* cur, const fs_file_t* prev);
 
 /**
- * Delete cur and all the files contained in its subtree exploring it recursively.
- * @param cur: address of a pointer to the file to delete.
- * @pre   cur must be the address of a ->content.l_child or ->r_sibling field of an existing file.
- * @post  the requested file and all its children have been deleted; their cells in the hash table contain the value FS_DELETED.
- * @pre   cur is the address of a valid file pointer (not NULL or referencing NULL).
+ * Get the content of a file.
+ * @param file: the file.
+ * @param len : reference to a variable where the length of the content will be stored.
+ * @ret   the NUL-terminated content of the file.
+ * @pre   file is not a directory.
  */
-void fs__del(fs_file_t** cur);
+const char* fs__data(const fs_file_t* file, size_t* len);
 
 /**
- * Compare two paths using strcmp and return the result. Used as compare function for qsort.
- * @param a: first path to compare.
- * @param b: second path to compare.
- * @ret   <>= 0 wether a comes before b, after b or is equal to b.
+ * Replace the content of a file with a copy of the given data: store it inside the file if it's short enough, or in the buffer the file already has if it fits there (and isn't mostly unused), otherwise in a new one.
+ * @param file: the file.
+ * @param data: the new content (not necessarily NUL-terminated).
+ * @param len : the length of the new content.
+ * @pre   file is not a directory and len is less than UINT32_MAX.
+ * @post  with FS_DEDUP_CONTENTS, a content which doesn't fit in the file is always shared with the other files with the same content.
+ */
+void fs__write(fs_file_t* file, const char* data, size_t len);
+
+/**
+ * Append the given data to the content of a file, growing its buffer geometrically when it doesn't fit.
+ * @param file: the file.
+ * @param data: the data to append (not necessarily NUL-terminated).
+ * @param len : the length of data.
+ * @ret   true in case of success, false if the content would be too long.
+ * @pre   file is not a directory.
+ */
+bool fs__append(fs_file_t* file, const char* data, size_t len);
+
+/**
+ * Delete cur and all the files contained in its subtree exploring it recursively.
+ * @param cur: the file to delete.
+ * @post  the requested file and all its children have been deleted and their cells in the hash table marked as deleted; if too many cells are now deleted or the table is too empty, it has been rebuilt or shrunk (with FS_DIRECTORY_INDEX, the table of a directory is destroyed together with its last child).
+ *        With FS_LAZY_DELETE, a directory which isn't empty is only detached from the tree, and its subtree is freed a few files at a time by the following operations.
+ * @pre   cur is a valid file pointer (not NULL) and is not the root.
  */
-int fs__cmp(const void* a, const void* b);
+void fs__del(fs_file_t* cur);
 
 #endif
@@ -18,24 +18,126 @@
  * limitations under the License.
  */
 
-#include <stddef.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
 #include "hash.h"
 
+static uint64_t const HASH_P0 = UINT64_C(0xa0761d6478bd642f);
+static uint64_t const HASH_P1 = UINT64_C(0xe7037ed1a0b428db);
+
+/**
+ * Multiply a and b as 128-bit values, storing the low half of the result in a and the high half in b.
+ */
+static inline void mum(uint64_t* a, uint64_t* b) {
+#ifdef __SIZEOF_INT128__
+	__uint128_t r;
+
+	r  = (__uint128_t)*a * *b;
+	*a = (uint64_t)r;
+	*b = (uint64_t)(r >> 64);
+#else
+	uint64_t ha, hb, la, lb, hi, lo, rh, rm0, rm1, rl;
+
+	ha  = *a >> 32;
+	hb  = *b >> 32;
+	la  = (uint32_t)*a;
+	lb  = (uint32_t)*b;
+	rh  = ha * hb;
+	rm0 = ha * lb;
+	rm1 = hb * la;
+	rl  = la * lb;
+	lo  = rl + (rm0 << 32);
+	hi  = rh + (rm0 >> 32) + (rm1 >> 32) + (lo < rl);
+	rl  = lo;
+	lo += rm1 << 32;
+	hi += lo < rl;
+	*a  = lo;
+	*b  = hi;
+#endif
+}
+
+/**
+ * Multiply a and b as 128-bit values and fold the result back to 64 bits.
+ */
+static inline uint64_t mix(uint64_t a, uint64_t b) {
+	mum(&a, &b);
+	return a ^ b;
+}
+
+static inline uint64_t read64(const unsigned char* p) {
+	uint64_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline uint64_t read32(const unsigned char* p) {
+	uint32_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
 /**
- * Is it simple? Yes.
- * Is it fast? Yes.
- * Is it good? I don't really think so.
- * Does it work well for this project? Hell yeah.
+ * Simple? Not anymore.
+ * Fast? Yes: it reads 8 or 16 bytes at a time, and names of up to 16 characters are hashed with just two multiplications.
+ * Good? Yes: this is the wyhash construction, every input bit affects the whole result.
+ * Does it still work well for this project? Hell yeah.
  */
-size_t hash(const char* key, size_t seed, size_t table_size) {
-	size_t h;
-	char c;
-	
-	h = seed;
-	while ((c = *key++)) {
-		h +=c;		
-		h = (h << 7) ^ h;
+uint64_t hash(const char* key, size_t len, uint64_t seed) {
+	const unsigned char* p;
+	uint64_t a, b;
+	size_t i;
+
+	p = (const unsigned char*)key;
+
+	if (len <= 16) {
+		if (len >= 4) {
+			a = (read32(p) << 32) | read32(p + ((len >> 3) << 2));
+			b = (read32(p + len - 4) << 32) | read32(p + len - 4 - ((len >> 3) << 2));
+		} else if (len > 0) {
+			a = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+			b = 0;
+		} else {
+			a = 0;
+			b = 0;
+		}
+	} else {
+		for (i = len; i > 16; i -= 16, p += 16)
+			seed = mix(read64(p) ^ HASH_P1, read64(p + 8) ^ seed);
+
+		a = read64(p + i - 16);
+		b = read64(p + i - 8);
+	}
+
+	a ^= HASH_P1;
+	b ^= seed;
+	mum(&a, &b);
+
+	return mix(a ^ HASH_P0 ^ len, b ^ HASH_P1);
+}
+
+uint64_t hash_combine(uint64_t a, uint64_t b) {
+	return mix(a ^ HASH_P0, b ^ HASH_P1);
+}
+
+uint64_t hash_random_seed(void) {
+	uint64_t seed;
+	FILE* urandom;
+
+	seed    = 0;
+	urandom = fopen("/dev/urandom", "rb");
+
+	if (urandom != NULL) {
+		if (fread(&seed, sizeof(seed), 1, urandom) != 1)
+			seed = 0;
+		fclose(urandom);
 	}
 
-	return h % table_size;
-}
\ No newline at end of file
+	if (seed == 0)
+		seed = mix((uint64_t)time(NULL) ^ HASH_P0, (uint64_t)clock() ^ (uint64_t)(uintptr_t)&seed);
+
+	return seed;
+}
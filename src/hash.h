@@ -21,13 +21,30 @@
 #ifndef API_PROJECT_HASH_INCLUDED
 #define API_PROJECT_HASH_INCLUDED
 
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Hash the string provided as key using the provided seed. Damn that's some good short description isn't it?
+ * @param key : the string to be hashed.
+ * @param len : the length of the string.
+ * @param seed: the seed (i.e. starting value).
+ * @ret   the computed 64-bit hash, to be reduced to the size of the table by the caller.
+ */
+uint64_t hash(const char* key, size_t len, uint64_t seed);
+
+/**
+ * Mix two 64-bit hashes into a new one, e.g. the hash of a name and the seed of its parent.
+ * @param a: the first hash.
+ * @param b: the second hash.
+ * @ret   the combined 64-bit hash.
+ */
+uint64_t hash_combine(uint64_t a, uint64_t b);
+
 /**
- * Hash the string provided as key for a table of the provided size and using the provided seed. Damn that's some good short description isn't it?
- * @param key       : the string to be hashed.
- * @param seed      : the seed (i.e. starting value).
- * @param table_size: size of the table to generate the hash for.
- * @ret   the computed hash.
+ * Generate a random seed, so that the hashes of the same keys are different in every process.
+ * @ret   64 bits read from /dev/urandom, or derived from the current time if it isn't available.
  */
-size_t hash(const char* key, size_t seed, size_t table_size);
+uint64_t hash_random_seed(void);
 
 #endif
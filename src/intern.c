@@ -0,0 +1,132 @@
+/**
+ * File  : intern.c
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include "utils.h"
+#include "hash.h"
+#include "intern.h"
+
+/****************************************************
+ *                      PRIVATE                     *
+ ****************************************************/
+
+#ifndef INTERN_TABLE_MAX_LOAD
+#define INTERN_TABLE_MAX_LOAD (2.0 / 3.0)
+#endif
+
+#ifndef INTERN_TABLE_MIN_LOAD
+#define INTERN_TABLE_MIN_LOAD (1.0 / 8.0)
+#endif
+
+/**
+ * Find the first empty cell from the index given by a hash.
+ * @param table: the table.
+ * @param h    : the hash.
+ * @ret   index of the empty cell.
+ */
+static size_t intern_empty(const intern_table_t* table, uint64_t h) {
+	register size_t i;
+
+	i = h & (table->size - 1);
+
+	while (table->cells[i] != NULL)
+		i = (i + 1) & (table->size - 1);
+
+	return i;
+}
+
+/**
+ * Allocate a new table with the given size and move all the entries there.
+ * @param table: the table.
+ * @param size : the size of the new table.
+ */
+static void intern_resize(intern_table_t* table, size_t size) {
+	intern_entry_t** old_cells;
+	size_t old_size, i;
+
+	old_cells    = table->cells;
+	old_size     = table->size;
+	table->cells = malloc_null(size, sizeof(intern_entry_t*));
+	table->size  = size;
+
+	for (i = 0; i < old_size; i++) {
+		if (old_cells[i] != NULL)
+			table->cells[intern_empty(table, old_cells[i]->hash)] = old_cells[i];
+	}
+
+	free(old_cells);
+}
+
+/****************************************************
+ *                      PUBLIC                      *
+ ****************************************************/
+
+void intern_init(intern_table_t* table, size_t init_size, size_t str_offset) {
+	table->cells      = malloc_null(init_size, sizeof(intern_entry_t*));
+	table->count      = 0;
+	table->size       = init_size;
+	table->init_size  = init_size;
+	table->str_offset = str_offset;
+	table->seed       = hash_random_seed();
+}
+
+void intern_exit(intern_table_t* table) {
+	free(table->cells);
+	table->cells = NULL;
+}
+
+uint64_t intern_hash(const intern_table_t* table, const char* str, size_t len) {
+	return hash(str, len, table->seed);
+}
+
+void intern_insert(intern_table_t* table, size_t i, intern_entry_t* entry) {
+	if ((float)(table->count + 1) / (float)table->size > INTERN_TABLE_MAX_LOAD) {
+		intern_resize(table, table->size * 2);
+		i = intern_empty(table, entry->hash);
+	}
+
+	table->cells[i] = entry;
+	table->count++;
+}
+
+void intern_remove(intern_table_t* table, intern_entry_t* entry) {
+	register size_t i, j, home, mask;
+
+	mask = table->size - 1;
+	i    = entry->hash & mask;
+
+	while (table->cells[i] != entry)
+		i = (i + 1) & mask;
+
+	/* Shift back the following entries of the cluster which can't be reached from their home cell anymore, so that no deleted mark is needed. */
+	table->cells[i] = NULL;
+
+	for (j = (i + 1) & mask; table->cells[j] != NULL; j = (j + 1) & mask) {
+		home = table->cells[j]->hash & mask;
+
+		if (((j - home) & mask) >= ((j - i) & mask)) {
+			table->cells[i] = table->cells[j];
+			table->cells[j] = NULL;
+			i = j;
+		}
+	}
+
+	table->count--;
+
+	if (table->size > table->init_size && (float)table->count / (float)table->size < INTERN_TABLE_MIN_LOAD)
+		intern_resize(table, table->size / 2);
+}
@@ -0,0 +1,108 @@
+/**
+ * File  : intern.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef API_PROJECT_INTERN_INCLUDED
+#define API_PROJECT_INTERN_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef struct intern_entry_s intern_entry_t;
+typedef struct intern_table_s intern_table_t;
+
+/**
+ * Fields common to all the strings kept in an interning table: the types of strings start with this structure, and hold the string itself at a fixed offset from it.
+ */
+struct intern_entry_s {
+	size_t refs;
+	size_t len;
+	uint64_t hash;
+};
+
+/**
+ * Hash table of unique strings with linear probing, keeping no deleted marks.
+ */
+struct intern_table_s {
+	intern_entry_t** cells;
+	size_t count;
+	size_t size;
+	size_t init_size;
+	size_t str_offset;
+	uint64_t seed;
+};
+
+/**
+ * Initialize an empty table with a random seed.
+ * @param table     : the table to initialize.
+ * @param init_size : the size of the table, below which it never shrinks.
+ * @param str_offset: the offset of the string from the start of an entry.
+ * @pre   init_size is a power of two: hashes are reduced to cell indexes by masking (see intern_probe).
+ */
+void intern_init(intern_table_t* table, size_t init_size, size_t str_offset);
+
+/**
+ * Destroy the table, without freeing the entries still in it.
+ * @param table: the table to destroy.
+ */
+void intern_exit(intern_table_t* table);
+
+/**
+ * Hash a string with the seed of the table.
+ * @param table: the table.
+ * @param str  : the string to hash.
+ * @param len  : the length of the string.
+ * @ret   the hash of the string.
+ */
+uint64_t intern_hash(const intern_table_t* table, const char* str, size_t len);
+
+/**
+ * Scan the table with linear probing from the index given by the hash until the string or an empty cell is found.
+ * @param table: the table.
+ * @param str  : the string to match.
+ * @param len  : the length of the string.
+ * @param h    : the hash of the string.
+ * @ret   index of the cell containing the string, or of the empty cell where it should be inserted.
+ */
+static inline size_t intern_probe(const intern_table_t* table, const char* str, size_t len, uint64_t h) {
+	register size_t i;
+	intern_entry_t* entry;
+
+	i = h & (table->size - 1);
+
+	while ((entry = table->cells[i]) != NULL && (entry->hash != h || entry->len != len || memcmp((const char*)entry + table->str_offset, str, len) != 0))
+		i = (i + 1) & (table->size - 1);
+
+	return i;
+}
+
+/**
+ * Add a new entry in the empty cell found by intern_probe, growing the table first if it's too full.
+ * @param table: the table.
+ * @param i    : the index returned by intern_probe for the string of the entry.
+ * @param entry: the entry to add, with its len and hash set.
+ */
+void intern_insert(intern_table_t* table, size_t i, intern_entry_t* entry);
+
+/**
+ * Remove an entry from the table, shrinking it afterwards if it's too empty.
+ * @param table: the table.
+ * @param entry: the entry to remove.
+ * @pre   entry is in the table.
+ */
+void intern_remove(intern_table_t* table, intern_entry_t* entry);
+
+#endif
@@ -22,76 +22,108 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <unistd.h>
 #include "utils.h"
+#include "reader.h"
+#include "writer.h"
+#include "command.h"
+#include "proto.h"
 #include "filesystem_core.h"
 #include "filesystem_api.h"
+#ifdef FS_PIPELINE
+#include "pipeline.h"
+#endif
 
-#define COMMAND_CREATE 'c'
-#define COMMAND_DELETE 'd'
-#define COMMAND_READ   'r'
-#define COMMAND_WRITE  'w'
-#define COMMAND_FIND   'f'
-#define COMMAND_EXIT   'e'
+#define USAGE "usage: %s [-b | -c]\n" \
+              "  -b: read commands and write results in the binary protocol\n" \
+              "  -c: convert commands from text to the binary protocol, without running them\n"
 
-int main(void) {
-	char *line, *cmd, *arg, *str;
-	int chars_read;
+/* The names of the path of the command being run, which points to them. */
+static fs_path_name_t names[COMMAND_MAX_NAMES];
+
+/**
+ * Run the commands read from stdin, in text or in the binary protocol, until an exit command or the end of the input.
+ * @param binary: whether the commands are in the binary protocol.
+ * @post  all the results have been written to stdout.
+ */
+static void run(bool binary) {
+	command_t cmd;
+	char* line;
+	size_t line_len;
+	reader_t input;
 	bool done;
 
-	fs_init();
+	reader_init(&input, STDIN_FILENO, fs_flush);
 	done = false;
 
-	while (!done) {
-		chars_read = getdelims(&line, "\r\n", stdin);
-
-		if (chars_read == 0) {
-			free(line);
-			continue;
+	if (binary) {
+		while (!done && proto_read(&input, &cmd, names))
+			done = command_run(&cmd);
+	} else {
+		while (!done && (line = reader_line(&input, &line_len)) != NULL) {
+			if (command_parse(line, line_len, &cmd, names))
+				done = command_run(&cmd);
 		}
+	}
 
-		if (chars_read == -1) {
-			free(line);
-			break;
-		}
+	/* Without an exit command, the results still in the buffer are written out at the end of the input. */
+	if (!done) {
+		fs_flush();
+		fs_stats();
+	}
 
-		cmd = strtok(line, " \t");
-		arg = strtok(NULL, " \t\r\n");
+	reader_free(&input);
+}
 
-		switch (cmd[0]) {
-			case COMMAND_CREATE:
-				fs_create(arg, (bool)cmd[6]);
-				break;
+/**
+ * Convert the commands read from stdin from text to the binary protocol, writing them to stdout.
+ */
+static void convert(void) {
+	command_t cmd;
+	char* line;
+	size_t line_len;
+	reader_t input;
+	writer_t output;
+
+	reader_init(&input, STDIN_FILENO, NULL);
+	writer_init(&output, STDOUT_FILENO);
+
+	while ((line = reader_line(&input, &line_len)) != NULL) {
+		if (command_parse(line, line_len, &cmd, names))
+			proto_write(&output, &cmd);
+	}
 
-			case COMMAND_DELETE:
-				fs_delete(arg, (bool)cmd[6]);
-				break;
+	writer_free(&output);
+	reader_free(&input);
+}
 
-			case COMMAND_READ:
-				fs_read(arg);
-				break;
+int main(int argc, char** argv) {
+	bool binary;
 
-			case COMMAND_WRITE:
-				str = strtok(NULL, "\r\n");
-				if (str != NULL) {
-					str = strchr(str, '"');
-					str = strtok(str, "\"");
-				}
+	binary = argc > 1 && strcmp(argv[1], "-b") == 0;
 
-				fs_write(arg, str);
-				break;
+	if (argc > 2 || (argc == 2 && !binary && strcmp(argv[1], "-c") != 0)) {
+		fprintf(stderr, USAGE, argv[0]);
+		return EXIT_FAILURE;
+	}
 
-			case COMMAND_FIND:
-				fs_find(arg);
-				break;
+	if (argc == 2 && !binary) {
+		convert();
+		return 0;
+	}
 
-			case COMMAND_EXIT:
-				done = true;
-				fs_exit();
-				break;
-		}
+	fs_init();
+	fs_protocol(binary);
 
-		free(line);
+#ifdef FS_PIPELINE
+	/* The pipeline only parses text: commands in the binary protocol are cheap enough to decode on the same thread. */
+	if (!binary) {
+		pipeline_run(STDIN_FILENO);
+		return 0;
 	}
+#endif
+
+	run(binary);
 
 	return 0;
 }
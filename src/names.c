@@ -0,0 +1,133 @@
+/**
+ * File  : names.c
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "utils.h"
+#include "pool.h"
+#include "intern.h"
+#include "names.h"
+
+/****************************************************
+ *                      PRIVATE                     *
+ ****************************************************/
+
+/* Initial (and minimum) size of the table of names, a power of two as required by intern_init. */
+#ifndef NAMES_TABLE_INIT_SIZE
+#define NAMES_TABLE_INIT_SIZE 1024
+#endif
+
+/* Names up to NAMES_POOL_CLASSES * NAMES_POOL_STEP bytes long (header included) are allocated from a pool of their size class. */
+#ifndef NAMES_POOL_STEP
+#define NAMES_POOL_STEP 16
+#endif
+
+#ifndef NAMES_POOL_CLASSES
+#define NAMES_POOL_CLASSES 8
+#endif
+
+static pool_t         names_pools[NAMES_POOL_CLASSES];
+static intern_table_t names_table;
+
+/**
+ * Get the pool of the size class of a name.
+ * @param len: the length of the name.
+ * @ret   the pool where the name belongs, NULL if it's too long and must be allocated with malloc.
+ */
+static inline pool_t* names_pool(size_t len) {
+	size_t class;
+
+	class = (sizeof(fs_name_t) + len) / NAMES_POOL_STEP;
+
+	return class < NAMES_POOL_CLASSES ? names_pools + class : NULL;
+}
+
+/****************************************************
+ *                      PUBLIC                      *
+ ****************************************************/
+
+void names_init(void) {
+	size_t i;
+
+	for (i = 0; i < NAMES_POOL_CLASSES; i++)
+		pool_init(names_pools + i, (i + 1) * NAMES_POOL_STEP);
+
+	intern_init(&names_table, NAMES_TABLE_INIT_SIZE, offsetof(fs_name_t, str));
+}
+
+void names_exit(void) {
+	size_t i;
+
+	for (i = 0; i < names_table.size; i++) {
+		if (names_table.cells[i] != NULL && names_pool(names_table.cells[i]->len) == NULL)
+			free(names_table.cells[i]);
+	}
+
+	for (i = 0; i < NAMES_POOL_CLASSES; i++)
+		pool_release(names_pools + i);
+
+	intern_exit(&names_table);
+}
+
+fs_name_t* name_find(const char* str, size_t len) {
+	return (fs_name_t*)names_table.cells[intern_probe(&names_table, str, len, intern_hash(&names_table, str, len))];
+}
+
+fs_name_t* name_intern(const char* str, size_t len) {
+	fs_name_t* name;
+	pool_t* pool;
+	uint64_t h;
+	size_t i;
+
+	h = intern_hash(&names_table, str, len);
+	i = intern_probe(&names_table, str, len, h);
+
+	if (names_table.cells[i] != NULL) {
+		names_table.cells[i]->refs++;
+		return (fs_name_t*)names_table.cells[i];
+	}
+
+	pool             = names_pool(len);
+	name             = pool != NULL ? pool_alloc(pool) : malloc_or_die(sizeof(fs_name_t) + len + 1);
+	name->entry.refs = 1;
+	name->entry.len  = len;
+	name->entry.hash = h;
+#ifndef FS_NO_NAME_INDEX
+	name->files = NULL;
+#endif
+	memcpy(name->str, str, len);
+	name->str[len] = '\0';
+
+	intern_insert(&names_table, i, &name->entry);
+
+	return name;
+}
+
+void name_release(fs_name_t* name) {
+	pool_t* pool;
+
+	if (--name->entry.refs > 0)
+		return;
+
+	intern_remove(&names_table, &name->entry);
+
+	pool = names_pool(name->entry.len);
+	if (pool != NULL)
+		pool_free(pool, name);
+	else
+		free(name);
+}
@@ -0,0 +1,70 @@
+/**
+ * File  : names.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef API_PROJECT_NAMES_INCLUDED
+#define API_PROJECT_NAMES_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include "intern.h"
+
+typedef struct fs_name_s fs_name_t;
+
+struct fs_file_s;
+
+struct fs_name_s {
+	intern_entry_t entry;
+#ifndef FS_NO_NAME_INDEX
+	struct fs_file_s* files;
+#endif
+	char str[];
+};
+
+/**
+ * Initialize the table of names with a random seed.
+ * @post the table of names has been allocated in memory and is empty.
+ */
+void names_init(void);
+
+/**
+ * Destroy the table of names, freeing at once all the names which haven't been released yet.
+ */
+void names_exit(void);
+
+/**
+ * Find an existing name.
+ * @param str: the name to search (not necessarily NUL-terminated).
+ * @param len: the length of the name.
+ * @ret   a pointer to the interned name, NULL if no file has such name.
+ */
+fs_name_t* name_find(const char* str, size_t len);
+
+/**
+ * Get the unique copy of a name, adding it to the table if needed, and take a reference to it.
+ * @param str: the name to intern (not necessarily NUL-terminated).
+ * @param len: the length of the name.
+ * @ret   a pointer to the interned name, which is the same for every equal string, with its refs increased by one (a new name has an empty list of files).
+ */
+fs_name_t* name_intern(const char* str, size_t len);
+
+/**
+ * Release a reference to an interned name, removing it from the table and freeing it if it was the last one.
+ * @param name: the name to release.
+ * @pre   name has been returned by name_intern.
+ */
+void name_release(fs_name_t* name);
+
+#endif
@@ -0,0 +1,317 @@
+/**
+ * File  : pipeline.c
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "utils.h"
+#include "reader.h"
+#include "writer.h"
+#include "ring.h"
+#include "command.h"
+#include "filesystem_core.h"
+#include "filesystem_api.h"
+#include "pipeline.h"
+
+/****************************************************
+ *                      PRIVATE                     *
+ ****************************************************/
+
+/* Batches and buffers in flight between two threads: enough for each thread to keep working while the next one is busy. */
+#ifndef PIPELINE_RING_SIZE
+#define PIPELINE_RING_SIZE 16
+#endif
+
+#ifndef PIPELINE_BATCH_SIZE
+#define PIPELINE_BATCH_SIZE (64 * 1024)
+#endif
+
+#ifndef PIPELINE_BATCH_COMMANDS
+#define PIPELINE_BATCH_COMMANDS 2048
+#endif
+
+#ifndef PIPELINE_BATCH_NAMES
+#define PIPELINE_BATCH_NAMES (8 * 1024)
+#endif
+
+typedef struct batch_s    batch_t;
+typedef struct pipeline_s pipeline_t;
+
+/**
+ * A batch of parsed commands, together with the lines and the names of the paths they point to.
+ */
+struct batch_s {
+	char*          buf;
+	size_t         size;
+	size_t         len;
+	size_t         n_cmds;
+	size_t         n_names;
+	command_t      cmds[PIPELINE_BATCH_COMMANDS];
+	fs_path_name_t names[PIPELINE_BATCH_NAMES + COMMAND_MAX_NAMES];
+};
+
+struct pipeline_s {
+	int       fd;
+	batch_t*  batch;
+	ring_t    commands;
+	ring_t    batches;
+	ring_t    output;
+	ring_t    buffers;
+	pthread_t parser;
+	pthread_t writer;
+};
+
+/* There's a single pipeline, also reached by the callbacks of the reader and of the writer, which take no arguments. */
+static pipeline_t pl;
+
+/**
+ * Get an empty batch, reusing one already run if any.
+ * @ret   the batch.
+ */
+static batch_t* get_batch(void) {
+	ring_item_t item;
+	batch_t* batch;
+
+	if (ring_try_pop(&pl.batches, &item)) {
+		batch = item.ptr;
+	} else {
+		batch       = malloc_or_die(sizeof(batch_t));
+		batch->size = PIPELINE_BATCH_SIZE;
+		batch->buf  = malloc_or_die(batch->size);
+	}
+
+	batch->len     = 0;
+	batch->n_cmds  = 0;
+	batch->n_names = 0;
+
+	return batch;
+}
+
+/**
+ * Free a batch.
+ * @param batch: the batch.
+ */
+static void free_batch(batch_t* batch) {
+	free(batch->buf);
+	free(batch);
+}
+
+/**
+ * Pass the current batch to the thread running the commands, if it contains any, and start a new one.
+ */
+static void send_batch(void) {
+	ring_item_t item;
+
+	if (pl.batch->n_cmds == 0)
+		return;
+
+	item.ptr = pl.batch;
+	item.len = pl.batch->n_cmds;
+	ring_push(&pl.commands, item);
+
+	pl.batch = get_batch();
+}
+
+/**
+ * Body of the parsing thread: read the lines, copy them in batches and parse them there.
+ * @param arg: unused.
+ * @ret   NULL.
+ * @post  a NULL batch has been sent after the last one.
+ */
+static void* parse_input(void* arg) {
+	ring_item_t end;
+	reader_t input;
+	command_t* cmd;
+	char* line;
+	size_t len;
+
+	(void)arg;
+
+	/* The commands read so far are sent before waiting for more input, since whoever sends it may wait for their results first. */
+	reader_init(&input, pl.fd, send_batch);
+	pl.batch = get_batch();
+
+	while ((line = reader_line(&input, &len)) != NULL) {
+		if (   pl.batch->len + len > pl.batch->size
+		    || pl.batch->n_cmds == PIPELINE_BATCH_COMMANDS
+		    || pl.batch->n_names > PIPELINE_BATCH_NAMES
+		)
+			send_batch();
+
+		/* A line longer than a whole batch gets an empty batch, grown to fit it. */
+		if (len > pl.batch->size) {
+			pl.batch->size = len;
+			pl.batch->buf  = realloc_or_die(pl.batch->buf, pl.batch->size);
+		}
+
+		memcpy(pl.batch->buf + pl.batch->len, line, len);
+		cmd = pl.batch->cmds + pl.batch->n_cmds;
+
+		if (command_parse(pl.batch->buf + pl.batch->len, len, cmd, pl.batch->names + pl.batch->n_names)) {
+			pl.batch->n_cmds++;
+			pl.batch->n_names += cmd->path.depth;
+			pl.batch->len     += len;
+		}
+	}
+
+	send_batch();
+	free_batch(pl.batch);
+	reader_free(&input);
+
+	end.ptr = NULL;
+	end.len = 0;
+	ring_push(&pl.commands, end);
+
+	return NULL;
+}
+
+/**
+ * Pass a full buffer of results to the writing thread, and get an empty one in exchange (see writer_hand).
+ * @param buf: the buffer.
+ * @param len: the length of its content.
+ * @ret   an empty buffer.
+ */
+static char* send_output(char* buf, size_t len) {
+	ring_item_t item;
+
+	item.ptr = buf;
+	item.len = len;
+	ring_push(&pl.output, item);
+
+	if (ring_try_pop(&pl.buffers, &item))
+		return item.ptr;
+
+	return malloc_or_die(WRITER_BLOCK_SIZE);
+}
+
+/**
+ * Body of the writing thread: write the buffers of results to stdout, in order.
+ * @param arg: unused.
+ * @ret   NULL.
+ */
+static void* write_output(void* arg) {
+	ring_item_t item;
+
+	(void)arg;
+
+	for (item = ring_pop(&pl.output); item.ptr != NULL; item = ring_pop(&pl.output)) {
+		writer_write(STDOUT_FILENO, item.ptr, item.len);
+
+		if (!ring_try_push(&pl.buffers, item))
+			free(item.ptr);
+	}
+
+	return NULL;
+}
+
+/**
+ * Free the items left in a ring, and the ring itself.
+ * @param ring     : the ring.
+ * @param free_item: the function freeing an item.
+ */
+static void drain(ring_t* ring, void (*free_item)(void*)) {
+	ring_item_t item;
+
+	while (ring_try_pop(ring, &item)) {
+		if (item.ptr != NULL)
+			free_item(item.ptr);
+	}
+
+	ring_free(ring);
+}
+
+/**
+ * Adapter of free_batch for drain.
+ * @param batch: the batch.
+ */
+static void free_batch_item(void* batch) {
+	free_batch(batch);
+}
+
+/****************************************************
+ *                      PUBLIC                      *
+ ****************************************************/
+
+void pipeline_run(int fd) {
+	ring_item_t item, end;
+	batch_t* batch;
+	bool done, eof;
+	size_t i;
+
+	pl.fd = fd;
+	ring_init(&pl.commands, PIPELINE_RING_SIZE);
+	ring_init(&pl.batches, PIPELINE_RING_SIZE);
+	ring_init(&pl.output, PIPELINE_RING_SIZE);
+	ring_init(&pl.buffers, PIPELINE_RING_SIZE);
+
+	fs_redirect(send_output);
+
+	if (   pthread_create(&pl.parser, NULL, parse_input, NULL) != 0
+	    || pthread_create(&pl.writer, NULL, write_output, NULL) != 0
+	) {
+		perror("pthread_create");
+		exit(EXIT_FAILURE);
+	}
+
+	done = false;
+	eof  = false;
+
+	while (!done) {
+		/* The results so far are written out before waiting for more commands, as they would be before waiting for more input. */
+		if (ring_empty(&pl.commands))
+			fs_flush();
+
+		item = ring_pop(&pl.commands);
+
+		if (item.ptr == NULL) {
+			eof = true;
+			fs_flush();
+			break;
+		}
+
+		batch = item.ptr;
+
+		for (i = 0; i < batch->n_cmds && !done; i++)
+			done = command_run(batch->cmds + i);
+
+		if (!ring_try_push(&pl.batches, item))
+			free_batch(batch);
+	}
+
+	/* After an exit command fs_exit has already handed the last results over. */
+	end.ptr = NULL;
+	end.len = 0;
+	ring_push(&pl.output, end);
+	pthread_join(pl.writer, NULL);
+	drain(&pl.output, free);
+	drain(&pl.buffers, free);
+
+	/* After an exit command the parsing thread may still be waiting for input: it's left to be terminated with the process. */
+	if (eof) {
+		pthread_join(pl.parser, NULL);
+		drain(&pl.commands, free_batch_item);
+		drain(&pl.batches, free_batch_item);
+	} else {
+		pthread_detach(pl.parser);
+	}
+
+	if (!done) {
+		fs_redirect(NULL);
+		fs_stats();
+	}
+}
@@ -0,0 +1,29 @@
+/**
+ * File  : pipeline.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef API_PROJECT_PIPELINE_INCLUDED
+#define API_PROJECT_PIPELINE_INCLUDED
+
+/**
+ * Run the commands read from the given file descriptor on three threads: one reads and parses the lines in batches, the calling thread (the only one touching the filesystem) runs them, and one writes the results to stdout. Batches of commands and buffers of results are passed between the threads through rings.
+ * The results and their order are the same as running the commands one by one; results are also written out every time the parsing thread waits for more input, as they would be without threads.
+ * @param fd: the file descriptor to read from.
+ * @pre   the filesystem has been initialized with fs_init.
+ * @post  all the commands up to an exit command (or to the end of the input) have been run, and all their results written.
+ */
+void pipeline_run(int fd);
+
+#endif
@@ -0,0 +1,108 @@
+/**
+ * File  : pool.c
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include "utils.h"
+#include "pool.h"
+
+/****************************************************
+ *                      PRIVATE                     *
+ ****************************************************/
+
+#ifndef POOL_CHUNK_MIN_OBJECTS
+#define POOL_CHUNK_MIN_OBJECTS 64
+#endif
+
+#ifndef POOL_CHUNK_MAX_OBJECTS
+#define POOL_CHUNK_MAX_OBJECTS 4096
+#endif
+
+/* Objects and chunk headers are aligned to this size, which is enough for any type stored in a pool (pointers and 64-bit integers). */
+#define POOL_ALIGN 8
+
+#define POOL_ROUND(sz) (((sz) + POOL_ALIGN - 1) & ~(size_t)(POOL_ALIGN - 1))
+
+/**
+ * Header of a chunk of objects: chunks are linked in a list so that they can all be freed at once.
+ */
+typedef struct pool_chunk_s {
+	struct pool_chunk_s* next;
+} pool_chunk_t;
+
+/**
+ * Allocate a new chunk of objects, once the previous one has been used up.
+ * @param pool: the pool.
+ */
+static void pool_grow(pool_t* pool) {
+	pool_chunk_t* chunk;
+
+	chunk        = malloc_or_die(POOL_ROUND(sizeof(pool_chunk_t)) + pool->size * pool->chunk_objects);
+	chunk->next  = pool->chunks;
+	pool->chunks = chunk;
+	pool->next   = (char*)chunk + POOL_ROUND(sizeof(pool_chunk_t));
+	pool->end    = pool->next + pool->size * pool->chunk_objects;
+
+	if (pool->chunk_objects < POOL_CHUNK_MAX_OBJECTS)
+		pool->chunk_objects *= 2;
+}
+
+/****************************************************
+ *                      PUBLIC                      *
+ ****************************************************/
+
+void pool_init(pool_t* pool, size_t size) {
+	pool->size          = POOL_ROUND(size < sizeof(void*) ? sizeof(void*) : size);
+	pool->chunk_objects = POOL_CHUNK_MIN_OBJECTS;
+	pool->free          = NULL;
+	pool->chunks        = NULL;
+	pool->next          = NULL;
+	pool->end           = NULL;
+}
+
+void* pool_alloc(pool_t* pool) {
+	void* obj;
+
+	/* Freed objects hold the pointer to the next free one in their first bytes. */
+	if (pool->free != NULL) {
+		obj        = pool->free;
+		pool->free = *(void**)obj;
+		return obj;
+	}
+
+	if (pool->next == pool->end)
+		pool_grow(pool);
+
+	obj         = pool->next;
+	pool->next += pool->size;
+
+	return obj;
+}
+
+void pool_free(pool_t* pool, void* obj) {
+	*(void**)obj = pool->free;
+	pool->free   = obj;
+}
+
+void pool_release(pool_t* pool) {
+	pool_chunk_t *chunk, *next;
+
+	for (chunk = pool->chunks; chunk != NULL; chunk = next) {
+		next = chunk->next;
+		free(chunk);
+	}
+
+	pool_init(pool, pool->size);
+}
@@ -0,0 +1,63 @@
+/**
+ * File  : pool.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef API_PROJECT_POOL_INCLUDED
+#define API_PROJECT_POOL_INCLUDED
+
+#include <stddef.h>
+
+typedef struct pool_s pool_t;
+
+struct pool_s {
+	size_t size;
+	size_t chunk_objects;
+	void*  free;
+	void*  chunks;
+	char*  next;
+	char*  end;
+};
+
+/**
+ * Initialize an empty pool of objects of the given size.
+ * @param pool: the pool to initialize.
+ * @param size: the size of each object.
+ * @post  no memory has been allocated yet: chunks are allocated on demand, each one twice as big as the previous one (up to POOL_CHUNK_MAX_OBJECTS objects).
+ */
+void pool_init(pool_t* pool, size_t size);
+
+/**
+ * Get an object from a pool, reusing the last one freed if any, and forcing the program to exit in case of failure.
+ * @param pool: the pool.
+ * @ret   a pointer to an uninitialized object, aligned to 8 bytes.
+ */
+void* pool_alloc(pool_t* pool);
+
+/**
+ * Give back an object to its pool, so that the next pool_alloc can reuse it.
+ * @param pool: the pool.
+ * @param obj : the object to free.
+ * @pre   obj has been returned by pool_alloc on the same pool.
+ */
+void pool_free(pool_t* pool, void* obj);
+
+/**
+ * Free all the memory of a pool at once, including the objects still in use.
+ * @param pool: the pool to release.
+ * @post  the pool is empty again and can still be used.
+ */
+void pool_release(pool_t* pool);
+
+#endif
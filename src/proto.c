@@ -0,0 +1,212 @@
+/**
+ * File  : proto.c
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "filesystem_core.h"
+#include "reader.h"
+#include "writer.h"
+#include "command.h"
+#include "proto.h"
+
+/****************************************************
+ *                      PRIVATE                     *
+ ****************************************************/
+
+/* A varint is at most 10 bytes long: 7 bits in each byte. */
+#define VARINT_MAX 10
+
+/**
+ * Decode the varint at the given offset of the unread input, reading more input if needed.
+ * @param reader: the reader.
+ * @param off   : reference to the offset, moved past the varint.
+ * @param value : reference to a variable where the value will be stored.
+ * @ret   true if the varint has been decoded, false if the input ended first.
+ */
+static bool get_varint(reader_t* reader, size_t* off, uint64_t* value) {
+	const unsigned char* buf;
+	unsigned shift;
+
+	*value = 0;
+
+	for (shift = 0; shift < 7 * VARINT_MAX; shift += 7) {
+		/* The reader is only asked for more input when the buffer runs out. */
+		if (*off >= reader->end - reader->start && reader_need(reader, *off + 1) == NULL)
+			return false;
+
+		buf = (const unsigned char*)reader->buf + reader->start;
+
+		*value |= (uint64_t)(buf[*off] & 0x7f) << shift;
+
+		if (!(buf[(*off)++] & 0x80))
+			return true;
+	}
+
+	return true;
+}
+
+/**
+ * Skip a string of the given length at the given offset of the unread input, reading more input if needed.
+ * @param reader: the reader.
+ * @param off   : reference to the offset, moved past the string.
+ * @param len   : the length of the string.
+ * @ret   true if the whole string is in the buffer, false if the input ended first.
+ */
+static bool get_string(reader_t* reader, size_t* off, uint64_t len) {
+	if (len > SIZE_MAX - *off)
+		return false;
+
+	if (*off + len > reader->end - reader->start && reader_need(reader, *off + len) == NULL)
+		return false;
+
+	*off += len;
+
+	return true;
+}
+
+/****************************************************
+ *                      PUBLIC                      *
+ ****************************************************/
+
+bool proto_read(reader_t* reader, command_t* cmd, fs_path_name_t* names) {
+	size_t offsets[COMMAND_MAX_NAMES];
+	const char* buf;
+	uint64_t n, i, len, data;
+	size_t off;
+	bool empty;
+
+	/* The whole command is first brought in the buffer, recording where the names are, then the names are pointed to, since reading more input may move the buffer. */
+	off = 1;
+	buf = reader_need(reader, 1);
+
+	if (buf == NULL)
+		return false;
+
+	cmd->code = buf[0];
+	cmd->flag = cmd->code == PROTO_CREATE_DIR || cmd->code == PROTO_DELETE_R;
+
+	if (cmd->flag)
+		cmd->code = cmd->code == PROTO_CREATE_DIR ? COMMAND_CREATE : COMMAND_DELETE;
+
+	if (!get_varint(reader, &off, &n))
+		return false;
+
+	empty = false;
+
+	for (i = 0; i < n; i++) {
+		if (!get_varint(reader, &off, &len))
+			return false;
+
+		/* Names are held to the same limit as contents, before bringing them in the buffer. */
+		if (len >= UINT32_MAX)
+			return false;
+
+		empty |= len == 0;
+
+		if (i < COMMAND_MAX_NAMES) {
+			offsets[i]   = off;
+			names[i].len = len;
+		}
+
+		if (!get_string(reader, &off, len))
+			return false;
+	}
+
+	/* The length of the content is stored plus one, so that 0 means there's no content at all. */
+	data = 0;
+
+	if (cmd->code == COMMAND_WRITE || cmd->code == COMMAND_APPEND) {
+		if (!get_varint(reader, &off, &data))
+			return false;
+
+		/* The length is stored plus one: no file can hold content that long, and it isn't worth bringing in the buffer just to refuse it. */
+		if (data > UINT32_MAX)
+			return false;
+
+		if (data > 0 && !get_string(reader, &off, data - 1))
+			return false;
+	}
+
+	buf           = reader->buf + reader->start;
+	cmd->data     = data > 0 ? buf + off - (data - 1) : NULL;
+	cmd->data_len = data > 0 ? data - 1 : 0;
+
+	/* A path with more names than any file could have, or with an empty name (which the text protocol can't express), refers to no file. */
+	if (n > COMMAND_MAX_NAMES || empty)
+		n = 0;
+
+	cmd->path.depth = n;
+	cmd->path.names = names;
+
+	for (i = 0; i < n; i++)
+		names[i].str = buf + offsets[i];
+
+	cmd->arg     = n > 0 ? names[0].str : NULL;
+	cmd->arg_len = n > 0 ? names[0].len : 0;
+
+	reader_skip(reader, off);
+
+	return true;
+}
+
+void proto_write(writer_t* writer, const command_t* cmd) {
+	size_t i;
+
+	switch (cmd->code) {
+		case COMMAND_CREATE:
+			writer_char(writer, cmd->flag ? PROTO_CREATE_DIR : COMMAND_CREATE);
+			break;
+
+		case COMMAND_DELETE:
+			writer_char(writer, cmd->flag ? PROTO_DELETE_R : COMMAND_DELETE);
+			break;
+
+		case COMMAND_READ:
+		case COMMAND_WRITE:
+		case COMMAND_APPEND:
+		case COMMAND_FIND:
+		case COMMAND_EXIT:
+			writer_char(writer, cmd->code);
+			break;
+
+		default:
+			return;
+	}
+
+	/* The name searched by find is the whole argument, slashes included. */
+	if (cmd->code == COMMAND_FIND) {
+		writer_varint(writer, cmd->arg != NULL);
+
+		if (cmd->arg != NULL) {
+			writer_varint(writer, cmd->arg_len);
+			writer_str(writer, cmd->arg, cmd->arg_len);
+		}
+	} else {
+		writer_varint(writer, cmd->path.depth);
+
+		for (i = 0; i < cmd->path.depth; i++) {
+			writer_varint(writer, cmd->path.names[i].len);
+			writer_str(writer, cmd->path.names[i].str, cmd->path.names[i].len);
+		}
+	}
+
+	if (cmd->code == COMMAND_WRITE || cmd->code == COMMAND_APPEND) {
+		writer_varint(writer, cmd->data != NULL ? cmd->data_len + 1 : 0);
+
+		if (cmd->data != NULL)
+			writer_str(writer, cmd->data, cmd->data_len);
+	}
+}
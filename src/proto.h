@@ -0,0 +1,51 @@
+/**
+ * File  : proto.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef API_PROJECT_PROTO_INCLUDED
+#define API_PROJECT_PROTO_INCLUDED
+
+#include <stdbool.h>
+#include "filesystem_core.h"
+#include "reader.h"
+#include "writer.h"
+#include "command.h"
+
+/* Code of the long forms of the commands (create_dir and delete_r) in the binary protocol. */
+#define PROTO_CREATE_DIR 'C'
+#define PROTO_DELETE_R   'D'
+
+/* First byte of a result in the binary protocol. */
+#define PROTO_SUCCESS 1
+#define PROTO_FAILURE 0
+
+/**
+ * Read the next command in the binary protocol (see doc/Binary protocol.md): its code, its path already split in names and, for write and append, its content.
+ * @param reader: the reader.
+ * @param cmd   : reference to the command where the result will be stored.
+ * @param names : array where the names of the path will be stored, with room for COMMAND_MAX_NAMES names.
+ * @ret   true if a command has been read, false if the input ended (or ended in the middle of a command, or holds a name or a content of UINT32_MAX bytes or more).
+ * @post  the command points inside the buffer of the reader, and stays valid until the next call.
+ */
+bool proto_read(reader_t* reader, command_t* cmd, fs_path_name_t* names);
+
+/**
+ * Write a command parsed from the text protocol in the binary protocol; commands the filesystem doesn't know are left out, as they would do nothing.
+ * @param writer: the writer.
+ * @param cmd   : the command.
+ */
+void proto_write(writer_t* writer, const command_t* cmd);
+
+#endif
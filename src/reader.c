@@ -0,0 +1,148 @@
+/**
+ * File  : reader.c
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* read(2) is POSIX, not C99: it is used since, unlike fread, it returns as soon as some input is available, so that commands typed on a terminal are still run one by one. */
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "utils.h"
+#include "reader.h"
+
+/****************************************************
+ *                      PRIVATE                     *
+ ****************************************************/
+
+#ifndef READER_BLOCK_SIZE
+#define READER_BLOCK_SIZE (64 * 1024)
+#endif
+
+/**
+ * Read the next block of input after what is already in the buffer, first moving the unread part to its beginning, or doubling its size if it is already full.
+ * @param reader: the reader.
+ * @post  reader->eof is true if nothing more can be read.
+ */
+static void reader_fill(reader_t* reader) {
+	ssize_t n;
+
+	if (reader->start > 0) {
+		memmove(reader->buf, reader->buf + reader->start, reader->end - reader->start);
+		reader->scan -= reader->start;
+		reader->lf    = reader->lf > reader->start ? reader->lf - reader->start : 0;
+		reader->end  -= reader->start;
+		reader->start = 0;
+	} else if (reader->end == reader->size) {
+		reader->size *= 2;
+		reader->buf   = realloc_or_die(reader->buf, reader->size + 1);
+	}
+
+	/* Whoever sends the input may be waiting for the results of the commands already read before sending more. */
+	if (reader->wait != NULL)
+		reader->wait();
+
+	do {
+		n = read(reader->fd, reader->buf + reader->end, reader->size - reader->end);
+	} while (n < 0 && errno == EINTR);
+
+	if (n <= 0)
+		reader->eof = true;
+	else
+		reader->end += n;
+}
+
+/****************************************************
+ *                      PUBLIC                      *
+ ****************************************************/
+
+void reader_init(reader_t* reader, int fd, void (*wait)(void)) {
+	/* One more character is always allocated, so that the last line can be terminated even if the buffer is full. */
+	reader->fd    = fd;
+	reader->size  = READER_BLOCK_SIZE;
+	reader->buf   = malloc_or_die(reader->size + 1);
+	reader->start = 0;
+	reader->scan  = 0;
+	reader->lf    = 0;
+	reader->end   = 0;
+	reader->eof   = false;
+	reader->wait  = wait;
+}
+
+char* reader_line(reader_t* reader, size_t* len) {
+	char *line, *stop, *cr, *end;
+
+	for (;;) {
+		/* What has already been scanned without finding a delimiter isn't scanned again after reading more. */
+		end = reader->buf + reader->end;
+
+		/* The next '\n' is remembered across calls (there's none between scan and lf), so lines ending with a lone '\r' don't search the rest of the buffer for it every time. */
+		if (reader->lf < reader->scan)
+			reader->lf = reader->scan;
+
+		if (reader->lf < reader->end && reader->buf[reader->lf] != '\n') {
+			stop       = memchr(reader->buf + reader->lf, '\n', end - (reader->buf + reader->lf));
+			reader->lf = stop != NULL ? (size_t)(stop - reader->buf) : reader->end;
+		}
+
+		stop = reader->lf < reader->end ? reader->buf + reader->lf : NULL;
+		cr   = memchr(reader->buf + reader->scan, '\r', (stop != NULL ? stop : end) - (reader->buf + reader->scan));
+
+		if (cr != NULL)
+			stop = cr;
+
+		if (stop != NULL || reader->eof)
+			break;
+
+		reader->scan = reader->end;
+		reader_fill(reader);
+	}
+
+	line = reader->buf + reader->start;
+
+	if (stop == NULL) {
+		if (line == end)
+			return NULL;
+
+		stop = end;
+	}
+
+	*len  = stop - line;
+	*stop = '\0';
+
+	reader->start = stop - reader->buf + (stop < end);
+	reader->scan  = reader->start;
+
+	return line;
+}
+
+char* reader_need(reader_t* reader, size_t n) {
+	while (reader->end - reader->start < n && !reader->eof)
+		reader_fill(reader);
+
+	return reader->end - reader->start >= n ? reader->buf + reader->start : NULL;
+}
+
+void reader_skip(reader_t* reader, size_t n) {
+	reader->start += n;
+	reader->scan   = reader->start;
+}
+
+void reader_free(reader_t* reader) {
+	free(reader->buf);
+	reader->buf = NULL;
+}
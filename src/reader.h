@@ -0,0 +1,78 @@
+/**
+ * File  : reader.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef API_PROJECT_READER_INCLUDED
+#define API_PROJECT_READER_INCLUDED
+
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef struct reader_s reader_t;
+
+struct reader_s {
+	int    fd;
+	char*  buf;
+	size_t size;
+	size_t start;
+	size_t scan;
+	size_t lf;
+	size_t end;
+	bool   eof;
+	void   (*wait)(void);
+};
+
+/**
+ * Initialize a reader of lines from the given file descriptor.
+ * @param reader: the reader to initialize.
+ * @param fd    : the file descriptor to read from (a regular file, a pipe or a terminal).
+ * @param wait  : function called every time the reader is about to read more input, which may block (e.g. to write out pending output first), NULL if none.
+ * @post  the buffer of the reader has been allocated, but nothing has been read yet.
+ */
+void reader_init(reader_t* reader, int fd, void (*wait)(void));
+
+/**
+ * Get the next line, reading a new block only when the buffer doesn't contain a whole one. Lines end at any '\r' or '\n', or at the end of the input; a line longer than the buffer makes it grow.
+ * @param reader: the reader.
+ * @param len   : reference to a variable where the length of the line will be stored.
+ * @ret   a pointer to the NUL-terminated line inside the buffer of the reader (without its delimiter), NULL if the end of the input has been reached.
+ * @post  the line can be modified, and stays valid until the next call.
+ */
+char* reader_line(reader_t* reader, size_t* len);
+
+/**
+ * Make sure that the given number of bytes of input, after what has already been consumed, is in the buffer, reading more if needed.
+ * @param reader: the reader.
+ * @param n     : the number of bytes.
+ * @ret   a pointer to the first byte not consumed yet, NULL if the input ends before n bytes.
+ * @post  the pointer stays valid until the next call.
+ */
+char* reader_need(reader_t* reader, size_t n);
+
+/**
+ * Consume the given number of bytes of input.
+ * @param reader: the reader.
+ * @param n     : the number of bytes.
+ * @pre   the bytes are in the buffer (see reader_need).
+ */
+void reader_skip(reader_t* reader, size_t n);
+
+/**
+ * Free the buffer of a reader.
+ * @param reader: the reader to free.
+ */
+void reader_free(reader_t* reader);
+
+#endif
@@ -0,0 +1,158 @@
+/**
+ * File  : ring.c
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "utils.h"
+#include "ring.h"
+
+/****************************************************
+ *                      PRIVATE                     *
+ ****************************************************/
+
+/* How many times a thread looks at a full (or empty) ring again before going to sleep. */
+#ifndef RING_SPIN
+#define RING_SPIN 1024
+#endif
+
+/* The head and the tail are published with GCC atomic builtins: C99 has no atomics of its own. */
+#define load(p)     __atomic_load_n((p), __ATOMIC_SEQ_CST)
+#define store(p, v) __atomic_store_n((p), (v), __ATOMIC_SEQ_CST)
+
+/**
+ * Tell whether a ring is full.
+ * @param ring: the ring.
+ * @ret   true if the ring is full, false otherwise.
+ */
+static bool is_full(ring_t* ring) {
+	return ring->tail - load(&ring->head) > ring->mask;
+}
+
+/**
+ * Tell whether a ring is empty.
+ * @param ring: the ring.
+ * @ret   true if the ring is empty, false otherwise.
+ */
+static bool is_empty(ring_t* ring) {
+	return load(&ring->tail) == ring->head;
+}
+
+/**
+ * Wait as long as the given condition holds: spin for a while, then sleep until the other thread changes the ring.
+ * @param ring   : the ring.
+ * @param blocked: the condition (is_full for the producer, is_empty for the consumer).
+ * @post  blocked(ring) is false.
+ */
+static void wait_while(ring_t* ring, bool (*blocked)(ring_t*)) {
+	size_t spins;
+
+	for (spins = 0; spins < RING_SPIN; spins++) {
+		if (!blocked(ring))
+			return;
+	}
+
+	/* The count of sleeping threads is raised before checking the ring again, and the other thread checks it after changing the ring, so at least one of them sees the other's change. It's a count and not a flag since a thread just woken up may still be counted when the other one goes to sleep. */
+	pthread_mutex_lock(&ring->lock);
+	__atomic_add_fetch(&ring->waiting, 1, __ATOMIC_SEQ_CST);
+
+	while (blocked(ring))
+		pthread_cond_wait(&ring->cond, &ring->lock);
+
+	__atomic_sub_fetch(&ring->waiting, 1, __ATOMIC_SEQ_CST);
+	pthread_mutex_unlock(&ring->lock);
+}
+
+/**
+ * Wake the other thread up, if it may be sleeping on the ring.
+ * @param ring: the ring.
+ */
+static void wake(ring_t* ring) {
+	if (load(&ring->waiting) > 0) {
+		pthread_mutex_lock(&ring->lock);
+		pthread_cond_broadcast(&ring->cond);
+		pthread_mutex_unlock(&ring->lock);
+	}
+}
+
+/****************************************************
+ *                      PUBLIC                      *
+ ****************************************************/
+
+void ring_init(ring_t* ring, size_t size) {
+	ring->slots   = malloc_or_die(size * sizeof(ring_item_t));
+	ring->mask    = size - 1;
+	ring->head    = 0;
+	ring->tail    = 0;
+	ring->waiting = 0;
+	pthread_mutex_init(&ring->lock, NULL);
+	pthread_cond_init(&ring->cond, NULL);
+}
+
+void ring_push(ring_t* ring, ring_item_t item) {
+	if (is_full(ring))
+		wait_while(ring, is_full);
+
+	ring->slots[ring->tail & ring->mask] = item;
+	store(&ring->tail, ring->tail + 1);
+	wake(ring);
+}
+
+bool ring_try_push(ring_t* ring, ring_item_t item) {
+	if (is_full(ring))
+		return false;
+
+	ring->slots[ring->tail & ring->mask] = item;
+	store(&ring->tail, ring->tail + 1);
+	wake(ring);
+
+	return true;
+}
+
+ring_item_t ring_pop(ring_t* ring) {
+	ring_item_t item;
+
+	if (is_empty(ring))
+		wait_while(ring, is_empty);
+
+	item = ring->slots[ring->head & ring->mask];
+	store(&ring->head, ring->head + 1);
+	wake(ring);
+
+	return item;
+}
+
+bool ring_try_pop(ring_t* ring, ring_item_t* item) {
+	if (is_empty(ring))
+		return false;
+
+	*item = ring->slots[ring->head & ring->mask];
+	store(&ring->head, ring->head + 1);
+	wake(ring);
+
+	return true;
+}
+
+bool ring_empty(ring_t* ring) {
+	return is_empty(ring);
+}
+
+void ring_free(ring_t* ring) {
+	pthread_mutex_destroy(&ring->lock);
+	pthread_cond_destroy(&ring->cond);
+	free(ring->slots);
+	ring->slots = NULL;
+}
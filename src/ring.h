@@ -0,0 +1,107 @@
+/**
+ * File  : ring.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef API_PROJECT_RING_INCLUDED
+#define API_PROJECT_RING_INCLUDED
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#ifndef RING_CACHE_LINE
+#define RING_CACHE_LINE 64
+#endif
+
+typedef struct ring_item_s ring_item_t;
+typedef struct ring_s      ring_t;
+
+/**
+ * An item passed through a ring: a buffer and the length of its content.
+ */
+struct ring_item_s {
+	void*  ptr;
+	size_t len;
+};
+
+/**
+ * A bounded queue with a single producer and a single consumer, which don't need a lock to push and pop: the head is only written by the consumer and the tail only by the producer, each in its own cache line.
+ * A thread which finds the ring full (or empty) spins for a while, then sleeps until the other one pops (or pushes) an item.
+ */
+struct ring_s {
+	ring_item_t* slots;
+	size_t       mask;
+	char         pad_head[RING_CACHE_LINE];
+	size_t       head;
+	char         pad_tail[RING_CACHE_LINE - sizeof(size_t)];
+	size_t       tail;
+	char         pad_wait[RING_CACHE_LINE - sizeof(size_t)];
+	int          waiting;
+	pthread_mutex_t lock;
+	pthread_cond_t  cond;
+};
+
+/**
+ * Initialize an empty ring.
+ * @param ring: the ring to initialize.
+ * @param size: the number of items the ring can hold.
+ * @pre   size is a power of 2.
+ */
+void ring_init(ring_t* ring, size_t size);
+
+/**
+ * Push an item at the tail of a ring, waiting while it's full; only called by the producer.
+ * @param ring: the ring.
+ * @param item: the item.
+ */
+void ring_push(ring_t* ring, ring_item_t item);
+
+/**
+ * Push an item at the tail of a ring, unless it's full; only called by the producer.
+ * @param ring: the ring.
+ * @param item: the item.
+ * @ret   true if the item has been pushed, false if the ring was full.
+ */
+bool ring_try_push(ring_t* ring, ring_item_t item);
+
+/**
+ * Pop the item at the head of a ring, waiting while it's empty; only called by the consumer.
+ * @param ring: the ring.
+ * @ret   the item.
+ */
+ring_item_t ring_pop(ring_t* ring);
+
+/**
+ * Pop the item at the head of a ring, unless it's empty; only called by the consumer.
+ * @param ring: the ring.
+ * @param item: reference to where the item will be stored.
+ * @ret   true if an item has been popped, false if the ring was empty.
+ */
+bool ring_try_pop(ring_t* ring, ring_item_t* item);
+
+/**
+ * Tell whether a ring is empty, i.e. whether the next pop would wait; only meaningful for the consumer.
+ * @param ring: the ring.
+ * @ret   true if the ring is empty, false otherwise.
+ */
+bool ring_empty(ring_t* ring);
+
+/**
+ * Free a ring (not the items still in it).
+ * @param ring: the ring to free.
+ */
+void ring_free(ring_t* ring);
+
+#endif
@@ -0,0 +1,211 @@
+/**
+ * File  : writer.c
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* write(2), writev(2) and isatty(3) are POSIX, not C99: they let results go out in large blocks, and one by one only when someone is reading them on a terminal. */
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include "utils.h"
+#include "writer.h"
+
+/****************************************************
+ *                      PRIVATE                     *
+ ****************************************************/
+
+/* Strings shorter than this are copied in the buffer even by writer_ref: a copy of a few KiB costs less than an extra system call. */
+#ifndef WRITER_COPY_MAX
+#define WRITER_COPY_MAX (16 * 1024)
+#endif
+
+/**
+ * Write the whole given data to a file descriptor, retrying after partial writes and interruptions.
+ * @param fd : the file descriptor.
+ * @param iov: the parts of the data, in order.
+ * @param n  : the number of parts.
+ * @post  the data has been written, unless an error occurred; iov has been modified.
+ */
+static void write_all(int fd, struct iovec* iov, int n) {
+	ssize_t written;
+
+	for (;;) {
+		/* Empty parts are skipped, so that nothing is left once the last part has been written. */
+		for (; n > 0 && iov->iov_len == 0; iov++, n--);
+
+		if (n == 0)
+			return;
+
+		written = n > 1 ? writev(fd, iov, n) : write(fd, iov->iov_base, iov->iov_len);
+
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+
+			return;
+		}
+
+		for (; n > 0 && (size_t)written >= iov->iov_len; iov++, n--)
+			written -= iov->iov_len;
+
+		if (n > 0) {
+			iov->iov_base  = (char*)iov->iov_base + written;
+			iov->iov_len  -= written;
+		}
+	}
+}
+
+/****************************************************
+ *                      PUBLIC                      *
+ ****************************************************/
+
+void writer_write(int fd, const char* str, size_t len) {
+	struct iovec iov;
+
+	iov.iov_base = (char*)str;
+	iov.iov_len  = len;
+	write_all(fd, &iov, 1);
+}
+
+void writer_init(writer_t* writer, int fd) {
+	writer->fd          = fd;
+	writer->size        = WRITER_BLOCK_SIZE;
+	writer->buf         = malloc_or_die(writer->size);
+	writer->len         = 0;
+	writer->interactive = isatty(fd);
+	writer->ref         = NULL;
+	writer->ref_len     = 0;
+	writer->ref_at      = 0;
+	writer->hand        = NULL;
+}
+
+void writer_hand(writer_t* writer, char* (*hand)(char* buf, size_t len)) {
+	writer_flush(writer);
+	writer->hand = hand;
+}
+
+void writer_str(writer_t* writer, const char* str, size_t len) {
+	if (len > writer->size - writer->len) {
+		writer_flush(writer);
+
+		if (len >= writer->size && writer->hand == NULL) {
+			writer_write(writer->fd, str, len);
+			return;
+		}
+
+		/* A buffer handed over is written later, so a large string has to be copied, one whole buffer at a time. */
+		for (; len > writer->size; str += writer->size, len -= writer->size) {
+			memcpy(writer->buf, str, writer->size);
+			writer->len = writer->size;
+			writer_flush(writer);
+		}
+	}
+
+	memcpy(writer->buf + writer->len, str, len);
+	writer->len += len;
+}
+
+void writer_ref(writer_t* writer, const char* str, size_t len) {
+	if (len < WRITER_COPY_MAX || writer->hand != NULL) {
+		writer_str(writer, str, len);
+		return;
+	}
+
+	if (writer->ref != NULL)
+		writer_flush(writer);
+
+	writer->ref     = str;
+	writer->ref_len = len;
+	writer->ref_at  = writer->len;
+}
+
+void writer_char(writer_t* writer, char c) {
+	if (writer->len == writer->size)
+		writer_flush(writer);
+
+	writer->buf[writer->len++] = c;
+}
+
+void writer_num(writer_t* writer, size_t n) {
+	char digits[20];
+	size_t i;
+
+	/* The digits are produced from the last one, at the end of a buffer large enough for any 64-bit number. */
+	i = sizeof(digits);
+
+	do {
+		digits[--i] = '0' + n % 10;
+		n /= 10;
+	} while (n > 0);
+
+	writer_str(writer, digits + i, sizeof(digits) - i);
+}
+
+void writer_varint(writer_t* writer, size_t n) {
+	char bytes[10];
+	size_t i;
+
+	for (i = 0; n >= 0x80; i++, n >>= 7)
+		bytes[i] = (char)(n & 0x7f) | (char)0x80;
+
+	bytes[i++] = (char)n;
+	writer_str(writer, bytes, i);
+}
+
+void writer_done(writer_t* writer) {
+	if (writer->interactive || writer->ref != NULL)
+		writer_flush(writer);
+}
+
+void writer_flush(writer_t* writer) {
+	struct iovec iov[3];
+	int n;
+
+	if (writer->hand != NULL) {
+		if (writer->len > 0)
+			writer->buf = writer->hand(writer->buf, writer->len);
+
+		writer->len = 0;
+		return;
+	}
+
+	iov[0].iov_base = writer->buf;
+	iov[0].iov_len  = writer->len;
+	n = 1;
+
+	/* The string held by reference goes between what was in the buffer before and after it was added. */
+	if (writer->ref != NULL) {
+		iov[0].iov_len  = writer->ref_at;
+		iov[1].iov_base = (char*)writer->ref;
+		iov[1].iov_len  = writer->ref_len;
+		iov[2].iov_base = writer->buf + writer->ref_at;
+		iov[2].iov_len  = writer->len - writer->ref_at;
+		writer->ref     = NULL;
+		n = 3;
+	}
+
+	write_all(writer->fd, iov, n);
+	writer->len = 0;
+}
+
+void writer_free(writer_t* writer) {
+	writer_flush(writer);
+	free(writer->buf);
+	writer->buf = NULL;
+}
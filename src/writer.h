@@ -0,0 +1,121 @@
+/**
+ * File  : writer.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef API_PROJECT_WRITER_INCLUDED
+#define API_PROJECT_WRITER_INCLUDED
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifndef WRITER_BLOCK_SIZE
+#define WRITER_BLOCK_SIZE (64 * 1024)
+#endif
+
+typedef struct writer_s writer_t;
+
+struct writer_s {
+	int    fd;
+	char*  buf;
+	size_t size;
+	size_t len;
+	bool   interactive;
+	const char* ref;
+	size_t ref_len;
+	size_t ref_at;
+	char*  (*hand)(char* buf, size_t len);
+};
+
+/**
+ * Write the whole given data to a file descriptor right away, retrying after partial writes and interruptions.
+ * @param fd : the file descriptor.
+ * @param str: the data (not necessarily NUL-terminated).
+ * @param len: the length of the data.
+ */
+void writer_write(int fd, const char* str, size_t len);
+
+/**
+ * Initialize a writer of results to the given file descriptor.
+ * @param writer: the writer to initialize.
+ * @param fd    : the file descriptor to write to.
+ * @post  the buffer of the writer has been allocated; the writer is interactive if fd is a terminal.
+ */
+void writer_init(writer_t* writer, int fd);
+
+/**
+ * Make a writer hand its buffer over to the given function every time it would be written, instead of writing it itself (e.g. to write it on another thread); strings added by writer_ref are then copied as any other.
+ * @param writer: the writer.
+ * @param hand  : function taking a buffer allocated with malloc and the length of its content, and returning an empty one of WRITER_BLOCK_SIZE bytes (also allocated with malloc); NULL to go back to writing.
+ */
+void writer_hand(writer_t* writer, char* (*hand)(char* buf, size_t len));
+
+/**
+ * Append a string to the buffer of a writer, flushing it first if the string doesn't fit; a string as large as the whole buffer is written directly instead.
+ * @param writer: the writer.
+ * @param str   : the string (not necessarily NUL-terminated).
+ * @param len   : the length of the string.
+ */
+void writer_str(writer_t* writer, const char* str, size_t len);
+
+/**
+ * Append a string to the output of a writer without copying it, if it's large: it's written straight from where it is, together with what comes before and after it in the buffer (with a single writev), when the buffer is next flushed.
+ * @param writer: the writer.
+ * @param str   : the string (not necessarily NUL-terminated).
+ * @param len   : the length of the string.
+ * @pre   str stays valid and unchanged until the next call to writer_done or writer_flush.
+ */
+void writer_ref(writer_t* writer, const char* str, size_t len);
+
+/**
+ * Append a character to the buffer of a writer.
+ * @param writer: the writer.
+ * @param c     : the character.
+ */
+void writer_char(writer_t* writer, char c);
+
+/**
+ * Append the decimal representation of a number to the buffer of a writer.
+ * @param writer: the writer.
+ * @param n     : the number.
+ */
+void writer_num(writer_t* writer, size_t n);
+
+/**
+ * Append a number to the buffer of a writer as a varint: 7 bits in each byte, from the lowest ones, with the high bit set in all bytes but the last.
+ * @param writer: the writer.
+ * @param n     : the number.
+ */
+void writer_varint(writer_t* writer, size_t n);
+
+/**
+ * Mark the end of a result: the buffer of an interactive writer is flushed, so that each result is shown as soon as it's ready, and so is the buffer of any writer holding a string added by writer_ref.
+ * @param writer: the writer.
+ */
+void writer_done(writer_t* writer);
+
+/**
+ * Write everything in the buffer of a writer.
+ * @param writer: the writer.
+ * @post  the buffer is empty (if writing fails, what was in it is lost).
+ */
+void writer_flush(writer_t* writer);
+
+/**
+ * Flush and free the buffer of a writer.
+ * @param writer: the writer to free.
+ */
+void writer_free(writer_t* writer);
+
+#endif
@@ -0,0 +1,142 @@
+#!/usr/bin/python3
+
+# File  : decode_results.py
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Print the results written by `simplefs -b` as the text protocol would, given
+# the commands they answer (see doc/Binary protocol.md). Commands are read with
+# the same rules as simplefs: reading stops at an exit command, at a command cut
+# short by the end of the input, and at a name or content of 2^32 - 1 bytes or
+# more. Exits with an error if the results don't match the commands.
+
+import sys
+import argparse
+
+MAX_LEN = 2**32 - 1
+
+class Truncated(Exception):
+    pass
+
+def varint(buf, off):
+    value = 0
+    shift = 0
+
+    # At most 10 bytes, as in proto.c.
+    for _ in range(10):
+        if off >= len(buf):
+            raise Truncated()
+
+        byte = buf[off]
+        off += 1
+        value |= (byte & 0x7f) << shift
+        shift += 7
+
+        if not byte & 0x80:
+            break
+
+    return value, off
+
+def string(buf, off, length):
+    if off + length > len(buf):
+        raise Truncated()
+
+    return buf[off:off + length], off + length
+
+def commands(buf):
+    off = 0
+
+    try:
+        while off < len(buf):
+            code = chr(buf[off])
+            off += 1
+
+            n, off = varint(buf, off)
+
+            for _ in range(n):
+                length, off = varint(buf, off)
+                if length >= MAX_LEN:
+                    return
+
+                _, off = string(buf, off, length)
+
+            if code in 'wa':
+                data, off = varint(buf, off)
+                if data > MAX_LEN:
+                    return
+
+                if data > 0:
+                    _, off = string(buf, off, data - 1)
+
+            yield code
+
+            if code == 'e':
+                return
+    except Truncated:
+        return
+
+def decode(cmds, res, out):
+    off = 0
+
+    for code in commands(cmds):
+        if code == 'e':
+            break
+
+        # Unknown commands are left out by the converter, but they'd answer nothing anyway.
+        if code not in 'cCdDrwaf':
+            continue
+
+        status, off = string(res, off, 1)
+
+        if status == b'\x00':
+            out.write(b'no\n')
+        elif code in 'cCdD':
+            out.write(b'ok\n')
+        elif code in 'wa':
+            length, off = varint(res, off)
+            out.write(b'ok %d\n' % length)
+        elif code == 'r':
+            length, off = varint(res, off)
+            content, off = string(res, off, length)
+            out.write(b'contenuto ' + content + b'\n')
+        else:
+            count, off = varint(res, off)
+
+            for _ in range(count):
+                length, off = varint(res, off)
+                path, off = string(res, off, length)
+                out.write(b'ok ' + path + b'\n')
+
+    if off != len(res):
+        raise Truncated()
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode the results of the binary protocol to text.')
+    parser.add_argument('commands', help='file with the commands in the binary protocol')
+    parser.add_argument('results', help='file with the results written by simplefs -b')
+    args = parser.parse_args()
+
+    with open(args.commands, 'rb') as f:
+        cmds = f.read()
+
+    with open(args.results, 'rb') as f:
+        res = f.read()
+
+    try:
+        decode(cmds, res, sys.stdout.buffer)
+    except Truncated:
+        sys.stderr.write('%s: the results don\'t match the commands\n' % sys.argv[0])
+        sys.exit(1)
+
+if __name__ == '__main__':
+    main()
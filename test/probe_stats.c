@@ -0,0 +1,299 @@
+/**
+ * File  : probe_stats.c
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Report the average and maximum probe length of the files created by the given test files, placing them with the
+ * old and the new scheme. Every file successfully created by the test is inserted, in the order of creation, in a
+ * table with linear probing, sized as the smallest power of two which keeps the load under 2/3 (the worst case allowed
+ * by the filesystem before an expansion). Deletions are ignored: a file created again keeps its first cell.
+ *
+ * The old scheme is modeled as it was: the hash of a name is seeded with the cell of its parent (the root counting as
+ * cell 0), reduced with %, and the file goes to the first free cell from there, whose index in turn seeds its children.
+ * The new scheme combines the hash of the name with the 64-bit seed of the parent, and masks it.
+ *
+ *     $ make probe_stats
+ *     $ ./probe_stats ../test/input/cactus.in ../test/input/lindens.in
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "utils.h"
+#include "hash.h"
+
+typedef struct probe_stats_s probe_stats_t;
+typedef struct file_s        file_t;
+
+struct probe_stats_s {
+	double avg;
+	size_t max;
+};
+
+/**
+ * A distinct path created by a test file, in the order in which it first appears.
+ */
+struct file_s {
+	char*  path;
+	size_t order;
+	bool   is_dir;
+	bool   created;
+	size_t old_cell;
+	uint64_t new_seed;
+};
+
+/**
+ * The hash function used before, kept here for comparison (the old one stopped at the NUL instead of taking a length).
+ */
+static size_t old_hash(const char* key, size_t len, size_t seed, size_t table_size) {
+	size_t h;
+	size_t i;
+
+	h = seed;
+	for (i = 0; i < len; i++) {
+		h += key[i];
+		h  = (h << 7) ^ h;
+	}
+
+	return h % table_size;
+}
+
+static uint64_t names_seed;
+
+/**
+ * The seed of a file with the new hash: the hash of its interned name combined with the seed of its parent.
+ */
+static uint64_t new_hash(const char* key, size_t len, uint64_t seed) {
+	return hash_combine(hash(key, len, names_seed), seed);
+}
+
+/**
+ * Insert a file in a table with linear probing, starting from the given cell.
+ * @ret   the cell where the file has been placed.
+ */
+static size_t place(char* used, size_t size, size_t h, size_t* total, size_t* max) {
+	size_t len;
+
+	len = 1;
+
+	while (used[h]) {
+		h = (h + 1) & (size - 1);
+		len++;
+	}
+
+	used[h] = 1;
+	*total += len;
+
+	if (len > *max)
+		*max = len;
+
+	return h;
+}
+
+static int cmp_path(const void* a, const void* b) {
+	const file_t *fa = a, *fb = b;
+	int c;
+
+	c = strcmp(fa->path, fb->path);
+
+	return c != 0 ? c : (fa->order > fb->order) - (fa->order < fb->order);
+}
+
+static int cmp_order(const void* a, const void* b) {
+	const file_t* const* fa = a;
+	const file_t* const* fb = b;
+
+	return ((*fa)->order > (*fb)->order) - ((*fa)->order < (*fb)->order);
+}
+
+/**
+ * Compare a string with the first len characters of a path, as strcmp would.
+ */
+static int cmp_prefix(const char* str, const char* path, size_t len) {
+	int c;
+
+	c = strncmp(str, path, len);
+
+	return c != 0 ? c : str[len] != '\0';
+}
+
+/**
+ * Find the parent of a file among the distinct files sorted by path.
+ * @ret   the parent, NULL if it is the root or if no test command creates it.
+ */
+static file_t* find_parent(file_t* files, size_t n, const char* path, bool* is_root) {
+	const char* slash;
+	size_t len, lo, hi, mid;
+
+	slash    = strrchr(path, '/');
+	*is_root = slash == NULL || slash == path;
+
+	if (*is_root)
+		return NULL;
+
+	len = (size_t)(slash - path);
+	lo  = 0;
+	hi  = n;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+
+		if (cmp_prefix(files[mid].path, path, len) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo < n && cmp_prefix(files[lo].path, path, len) == 0 ? files + lo : NULL;
+}
+
+/**
+ * Collect the distinct paths of the files created by a test file.
+ * @ret   number of paths found, -1 if the file can't be opened.
+ */
+static long read_files(const char* fname, file_t** files) {
+	size_t n, cap, i, j;
+	char *line, *cmd, *arg;
+	FILE* f;
+
+	f = fopen(fname, "r");
+	if (f == NULL)
+		return -1;
+
+	n      = 0;
+	cap    = 1024;
+	*files = malloc_or_die(cap * sizeof(file_t));
+
+	while (getdelims(&line, "\r\n", f) != -1) {
+		cmd = strtok(line, " \t");
+		arg = strtok(NULL, " \t");
+
+		if (cmd != NULL && arg != NULL && (strcmp(cmd, "create") == 0 || strcmp(cmd, "create_dir") == 0)) {
+			if (n == cap) {
+				cap   *= 2;
+				*files = realloc_or_die(*files, cap * sizeof(file_t));
+			}
+
+			(*files)[n].path    = malloc_or_die(strlen(arg) + 1);
+			(*files)[n].order   = n;
+			(*files)[n].is_dir  = strcmp(cmd, "create_dir") == 0;
+			(*files)[n].created = false;
+			strcpy((*files)[n++].path, arg);
+		}
+
+		free(line);
+	}
+
+	/* getdelims allocates the line even when it finds the end of the file. */
+	free(line);
+	fclose(f);
+
+	/* Only the first create of each path is kept: a later one either fails or recreates a deleted file. */
+	qsort(*files, n, sizeof(file_t), cmp_path);
+
+	for (i = 0, j = 0; i < n; i++) {
+		if (j > 0 && strcmp((*files)[j - 1].path, (*files)[i].path) == 0)
+			free((*files)[i].path);
+		else
+			(*files)[j++] = (*files)[i];
+	}
+
+	return (long)j;
+}
+
+int main(int argc, char** argv) {
+	probe_stats_t old_stats, new_stats;
+	size_t i, size, created, old_total, new_total, parent_cell;
+	uint64_t new_root, parent_seed;
+	char *old_used, *new_used, *name;
+	file_t *files, *parent, **by_order;
+	bool is_root;
+	long n;
+	int a;
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s FILE...\n", argv[0]);
+		return 1;
+	}
+
+	new_root   = hash_random_seed();
+	names_seed = hash_random_seed();
+
+	printf("%-24s %7s %8s   %8s %5s   %8s %5s\n", "file", "files", "size", "old avg", "max", "new avg", "max");
+
+	for (a = 1; a < argc; a++) {
+		n = read_files(argv[a], &files);
+
+		if (n < 0) {
+			fprintf(stderr, "%s: can't open %s\n", argv[0], argv[a]);
+			continue;
+		}
+
+		/* A create only succeeds if the parent has been created before as a directory. */
+		by_order = malloc_or_die((n + 1) * sizeof(file_t*));
+
+		for (i = 0; i < (size_t)n; i++)
+			by_order[i] = files + i;
+
+		qsort(by_order, n, sizeof(file_t*), cmp_order);
+
+		for (created = 0, i = 0; i < (size_t)n; i++) {
+			parent = find_parent(files, n, by_order[i]->path, &is_root);
+			by_order[i]->created = is_root || (parent != NULL && parent->created && parent->is_dir && parent->order < by_order[i]->order);
+			created += by_order[i]->created;
+		}
+
+		for (size = 16; (double)created / (double)size > 2.0 / 3.0; size *= 2);
+
+		old_used  = calloc_or_die(size, 1);
+		new_used  = calloc_or_die(size, 1);
+		old_total = 0;
+		new_total = 0;
+		old_stats.max = 0;
+		new_stats.max = 0;
+
+		for (i = 0; i < (size_t)n; i++) {
+			if (!by_order[i]->created)
+				continue;
+
+			parent      = find_parent(files, n, by_order[i]->path, &is_root);
+			parent_cell = is_root ? 0 : parent->old_cell;
+			parent_seed = is_root ? new_root : parent->new_seed;
+			name        = strrchr(by_order[i]->path, '/') + 1;
+
+			by_order[i]->old_cell = place(old_used, size, old_hash(name, strlen(name), parent_cell, size), &old_total, &old_stats.max);
+			by_order[i]->new_seed = new_hash(name, strlen(name), parent_seed);
+			place(new_used, size, by_order[i]->new_seed & (size - 1), &new_total, &new_stats.max);
+		}
+
+		old_stats.avg = created ? (double)old_total / (double)created : 0.0;
+		new_stats.avg = created ? (double)new_total / (double)created : 0.0;
+
+		printf("%-24s %7zu %8zu   %8.2f %5zu   %8.2f %5zu\n", strrchr(argv[a], '/') ? strrchr(argv[a], '/') + 1 : argv[a],
+		       created, size, old_stats.avg, old_stats.max, new_stats.avg, new_stats.max);
+
+		for (i = 0; i < (size_t)n; i++)
+			free(files[i].path);
+
+		free(old_used);
+		free(new_used);
+		free(by_order);
+		free(files);
+	}
+
+	return 0;
+}
@@ -109,6 +109,51 @@ function test_file {
 	fi
 }
 
+function test_binary {
+	spacing=$((28 - ${#1}))
+	fname=$(basename $1)
+	fname=${fname%.*}
+
+	printf "  [%2d/%2d] File \"%s\"" $2 $3 $1
+	(($spacing > 0)) && printf ".%.0s" $(seq 1 $spacing)
+	printf ": working on it...\r"
+
+	# Text commands are converted first, hand-built binary commands are run as they are.
+	if [ "${1%.in}" != "$1" ]; then
+		../build/simplefs -c < $1 > $TMPDIR/dummy_cmds
+		expected=output/$fname.out
+	else
+		cp $1 $TMPDIR/dummy_cmds
+		expected=output_bin/$fname.out
+	fi
+
+	tstart=$(date +%s%6N)
+	../build/simplefs -b < $TMPDIR/dummy_cmds > $TMPDIR/dummy_res
+	tend=$(date +%s%6N)
+
+	dt=$((tend - tstart))
+	dt=$(bc <<< "scale=3; ${dt}/1000")
+
+	printf "  [%2d/%2d] File \"%s\"" $2 $3 $1
+	(($spacing > 0)) && printf ".%.0s" $(seq 1 $spacing)
+	printf ": %7.3fms" $dt
+
+	./decode_results.py $TMPDIR/dummy_cmds $TMPDIR/dummy_res > $TMPDIR/dummy_out && cmp --quiet $TMPDIR/dummy_out $expected
+	res=$?
+
+	if [ $res -eq 0 ]; then
+		printf " -> OK.\n"
+	else
+		printf " -> ERROR!\n"
+		if [ $FORCE_TESTS -eq 1 ]; then
+			FAILED=1
+		else
+			printf "\n"
+			fail
+		fi
+	fi
+}
+
 function test_random {
     spacing=$((7 - ${#1} - ${#2}))
 	res=0
@@ -164,6 +209,7 @@ FORCE_TESTS=0
 TEST_MEMORY=0
 TEST_FILES=0
 TEST_RANDOM=0
+TEST_BINARY=0
 OPTION_ERR=0
 
 if [ -z "$*" ]; then
@@ -178,13 +224,15 @@ else
 				TEST_MEMORY=1;
 				TEST_FILES=1;
 				TEST_RANDOM=1;
+				TEST_BINARY=1;
 			elif [ "$option" = "force"  ]; then FORCE_TESTS=1;
 			elif [ "$option" = "memory" ]; then TEST_MEMORY=1;
 			elif [ "$option" = "files"  ]; then TEST_FILES=1;
 			elif [ "$option" = "random" ]; then TEST_RANDOM=1;
+			elif [ "$option" = "binary" ]; then TEST_BINARY=1;
 			else
 				if [ $OPTION_ERR -eq 0 ]; then
-					printf "usage: %s [force] [all] [memory] [files] [random]\n" $0
+					printf "usage: %s [force] [all] [memory] [files] [random] [binary]\n" $0
 					OPTION_ERR=1
 				fi
 				
@@ -223,6 +271,20 @@ if [ $TEST_FILES -eq 1 ]; then
 	printf "\n"
 fi
 
+if [ $TEST_BINARY -eq 1 ]; then
+	printf "Running all test files in the binary protocol:\n"
+
+	i=0
+	n=$(($(ls input -1 | wc -l) + $(ls input_bin -1 | wc -l)))
+
+	for f in input/*.in input_bin/*.bin; do
+		((i++))
+		test_binary $f $i $n
+	done
+
+	printf "\n"
+fi
+
 if [ $TEST_RANDOM -eq 1 ]; then
 	printf "Running randomly generated tests:\n"
 